@@ -0,0 +1,252 @@
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+// windows.h must come first
+#include <psapi.h>
+#elif __has_include(<sys/resource.h>)
+#include <sys/resource.h>
+#endif
+
+#include "nesturbia/nesturbia.hpp"
+
+namespace {
+
+// Constants
+constexpr uint32_t kDefaultFrames = 3600;
+constexpr uint32_t kDotsPerCpuCycle = 3;
+
+// Local types
+struct options_t {
+  std::string romPath;
+  uint32_t frames = kDefaultFrames;
+  nesturbia::Ppu::renderer_t renderer = nesturbia::Ppu::renderer_t::scanline;
+  nesturbia::Apu::synthesis_t synthesis = nesturbia::Apu::synthesis_t::blep;
+  nesturbia::FrameOutput output;
+};
+
+// Local variables
+nesturbia::Nesturbia emulator;
+
+// Audio is synthesized as usual, but thrown away
+std::array<float, 1024> audioBlock;
+
+// Local functions
+bool parseArguments(int argc, char **argv, options_t &options);
+bool loadRom(const std::string &romPath);
+nesturbia::Joypad::input_t scriptedInput(uint32_t frame);
+std::optional<uint64_t> peakResidentSetKiB();
+void printUsage();
+
+} // namespace
+
+int main(int argc, char **argv) {
+  options_t options;
+  if (!parseArguments(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  if (!loadRom(options.romPath)) {
+    return 1;
+  }
+
+  emulator.ppu.renderer = options.renderer;
+  emulator.cpu.apu.synthesis = options.synthesis;
+
+  nesturbia::AudioOutput audioOutput;
+  audioOutput.samples = audioBlock.data();
+  audioOutput.bufferSize = audioBlock.size();
+  emulator.SetAudioOutput(audioOutput, 44100);
+
+  uint64_t cpuCycles = 0;
+  uint64_t instructions = 0;
+
+  const auto startTime = std::chrono::steady_clock::now();
+
+  for (uint32_t frame = 0; frame < options.frames; frame++) {
+    // The counters are 32-bit, so accumulate the differences for each frame
+    const auto frameStartCycles = emulator.cpu.cycles;
+    const auto frameStartInstructions = emulator.cpu.instructions;
+
+    emulator.RunFrame(scriptedInput(frame), {}, options.output);
+
+    cpuCycles += static_cast<uint32_t>(emulator.cpu.cycles - frameStartCycles);
+    instructions += static_cast<uint32_t>(emulator.cpu.instructions - frameStartInstructions);
+  }
+
+  const auto endTime = std::chrono::steady_clock::now();
+
+  const auto ns = std::chrono::duration<double, std::nano>(endTime - startTime).count();
+  const auto ppuDots = cpuCycles * kDotsPerCpuCycle;
+  const auto peakRssKiB = peakResidentSetKiB();
+
+  // One JSON object, so that the results can be collected by scripts
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "{\"crc32\": \"" << std::hex << std::setw(8) << std::setfill('0')
+            << emulator.cartridge.crc32Hash << std::dec << "\", "
+            << "\"renderer\": \""
+            << (options.renderer == nesturbia::Ppu::renderer_t::dot ? "dot" : "scanline")
+            << "\", "
+            << "\"synthesis\": \""
+            << (options.synthesis == nesturbia::Apu::synthesis_t::average ? "average" : "blep")
+            << "\", "
+            << "\"video\": " << (options.output.video ? "true" : "false") << ", "
+            << "\"audio\": " << (options.output.audio ? "true" : "false") << ", "
+            << "\"frames\": " << options.frames << ", "
+            << "\"instructions\": " << instructions << ", "
+            << "\"cpuCycles\": " << cpuCycles << ", "
+            << "\"ppuDots\": " << ppuDots << ", "
+            << "\"seconds\": " << ns / 1e9 << ", "
+            << "\"fps\": " << (ns != 0 ? options.frames / (ns / 1e9) : 0.0) << ", "
+            << "\"nsPerInstruction\": " << (instructions != 0 ? ns / instructions : 0.0) << ", "
+            << "\"nsPerDot\": " << (ppuDots != 0 ? ns / ppuDots : 0.0) << ", "
+            << "\"peakRssKiB\": " << (peakRssKiB ? std::to_string(*peakRssKiB) : "null") << "}"
+            << std::endl;
+
+  return 0;
+}
+
+namespace {
+bool parseArguments(int argc, char **argv, options_t &options) {
+  for (int i = 1; i < argc; i++) {
+    const auto argument = std::string(argv[i]);
+    const auto hasValue = i + 1 < argc;
+
+    if (argument == "--frames" && hasValue) {
+      const char *value = argv[++i];
+      char *end = nullptr;
+      errno = 0;
+      const auto frames = std::strtoul(value, &end, 10);
+
+      // strtoul() also skips whitespace and takes a sign (negative numbers wrap around), so only
+      // plain digits are accepted
+      if (!std::isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' || errno == ERANGE ||
+          frames == 0 || frames > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "Expected a positive number of frames." << std::endl;
+        return false;
+      }
+
+      options.frames = static_cast<uint32_t>(frames);
+    } else if (argument == "--renderer" && hasValue) {
+      const auto renderer = std::string(argv[++i]);
+      if (renderer == "dot") {
+        options.renderer = nesturbia::Ppu::renderer_t::dot;
+      } else if (renderer == "scanline") {
+        options.renderer = nesturbia::Ppu::renderer_t::scanline;
+      } else {
+        std::cerr << "Unknown renderer '" << renderer << "'." << std::endl;
+        return false;
+      }
+    } else if (argument == "--synthesis" && hasValue) {
+      const auto synthesis = std::string(argv[++i]);
+      if (synthesis == "average") {
+        options.synthesis = nesturbia::Apu::synthesis_t::average;
+      } else if (synthesis == "blep") {
+        options.synthesis = nesturbia::Apu::synthesis_t::blep;
+      } else {
+        std::cerr << "Unknown synthesis mode '" << synthesis << "'." << std::endl;
+        return false;
+      }
+    } else if (argument == "--no-video") {
+      options.output.video = false;
+    } else if (argument == "--no-audio") {
+      options.output.audio = false;
+    } else if (options.romPath.empty() && argument.rfind("--", 0) != 0) {
+      options.romPath = argument;
+    } else {
+      std::cerr << "Unexpected argument '" << argument << "'." << std::endl;
+      return false;
+    }
+  }
+
+  if (options.romPath.empty()) {
+    std::cerr << "Expected a ROM path." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool loadRom(const std::string &romPath) {
+  if (std::filesystem::is_directory(romPath)) {
+    std::cerr << "ROM path '" << romPath << "' is a directory." << std::endl;
+    return false;
+  }
+
+  auto romFile = std::ifstream(romPath, std::ios::binary);
+  if (!romFile) {
+    std::cerr << "Could not open ROM '" << romPath << "'." << std::endl;
+    return false;
+  }
+
+  const auto rom = std::vector<uint8_t>(std::istreambuf_iterator<char>(romFile), {});
+  if (!emulator.LoadRom(rom.data(), rom.size())) {
+    std::cerr << "Could not load ROM '" << romPath << "'." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+nesturbia::Joypad::input_t scriptedInput(uint32_t frame) {
+  // The same sequence on every run, so that runs are comparable
+  // Start is tapped every 4 seconds to get past title screens, and the rest of the time is spent
+  // walking back and forth while pressing A and B
+  nesturbia::Joypad::input_t input;
+
+  const auto phase = frame % 240;
+  input.start = phase < 5;
+  input.right = phase >= 30 && phase < 130;
+  input.left = phase >= 140 && phase < 220;
+  input.a = (frame / 8) % 4 == 0;
+  input.b = (frame / 16) % 2 == 0;
+
+  return input;
+}
+
+// Returns nothing if the platform doesn't report it (which is printed as null)
+std::optional<uint64_t> peakResidentSetKiB() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters = {};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return std::nullopt;
+  }
+
+  return static_cast<uint64_t>(counters.PeakWorkingSetSize) / 1024;
+#elif __has_include(<sys/resource.h>)
+  rusage usage = {};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return std::nullopt;
+  }
+
+#ifdef __APPLE__
+  // macOS reports bytes
+  return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#else
+  return std::nullopt;
+#endif
+}
+
+void printUsage() {
+  std::cerr << "Usage: nesturbia-bench [--frames N] [--renderer dot|scanline]"
+            << " [--synthesis average|blep] [--no-video] [--no-audio] ROM" << std::endl;
+}
+} // namespace
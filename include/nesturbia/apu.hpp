@@ -0,0 +1,269 @@
+#ifndef NESTURBIA_APU_HPP_INCLUDED
+#define NESTURBIA_APU_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "nesturbia/serializer.hpp"
+#include "nesturbia/types.hpp"
+
+namespace nesturbia {
+
+// Where audio samples are written to
+// Samples are stored in the caller-provided buffer(s) and handed to the callback in blocks: when
+// the buffer is full, and at the end of each frame
+struct AudioOutput {
+  // Types
+  // Receives `numSamples` samples (mono); `int16Samples` is null if no 16-bit buffer was provided
+  using callback_t = void (*)(void *userData, const float *samples, const int16_t *int16Samples,
+                              size_t numSamples);
+
+  // Data
+  // Required to output audio
+  float *samples = nullptr;
+
+  // Optional: the same samples, converted to signed 16-bit
+  int16_t *int16Samples = nullptr;
+
+  // The number of samples that fit in each buffer
+  size_t bufferSize = 0;
+
+  callback_t callback = nullptr;
+  void *userData = nullptr;
+};
+
+// The APU: the sound channels, the frame counter, and the mixer that turns the channels' output
+// into samples
+// All of its state (including the mixer's) lives in the instance, so multiple emulators can run
+// side by side
+struct Apu {
+  // Types
+  struct length_counter_t {
+    // TODO halt isn't cleared on reset for triangle (keep in mind if implementing reset behavior)
+    bool halt = false;
+    // 5-bit value
+    uint8 value = 0;
+  };
+
+  struct envelope_t {
+    bool loop = false;
+    // Note: called 'constant volume' in some places
+    bool disabled = false;
+    // 4-bit value
+    uint8 volume = 0;
+    // 4-bit value
+    uint8 divider = 0;
+    // 4-bit value
+    uint8 count = 0;
+    bool reload = false;
+  };
+
+  struct pulse_channel_t {
+    bool enabled = false;
+
+    // 2-bit value
+    uint8 duty = 0;
+    // 3-bit value, wraps around
+    uint8 dutyIndex = 0;
+
+    length_counter_t length;
+    envelope_t envelope;
+
+    struct {
+      bool enabled = false;
+      // 3-bit value
+      uint8 period = 0;
+      // 3-bit value
+      uint8 divider = 0;
+      bool negate = false;
+      uint8 shiftAmount = 0;
+      bool reload = false;
+    } sweep;
+
+    // 11-bit value
+    uint16 period;
+
+    // 11-bit value
+    // TODO where to initialize (other than here obviously)?
+    uint16 timerCounter = 0;
+  };
+
+  struct triangle_channel_t {
+    bool enabled = false;
+
+    length_counter_t length;
+
+    // 5-bit value, wraps around
+    uint8 dutyIndex = 0;
+
+    struct {
+      bool control;
+      // 7-bit value
+      uint8 load = 0;
+      // 7-bit value
+      uint8 value = 0;
+      bool reload = false;
+    } linearCounter;
+
+    // 11-bit value
+    uint16 period;
+
+    // 11-bit value
+    // TODO where to initialize (other than here obviously)?
+    uint16 timerCounter = 0;
+  };
+
+  struct noise_channel_t {
+    bool enabled = false;
+
+    // Bit 7 of $400e
+    bool mode = false;
+
+    length_counter_t length;
+    envelope_t envelope;
+
+    // 12-bit value
+    uint16 period = 0;
+
+    // 12-bit value
+    // TODO where to initialize (other than here obviously)?
+    uint16 timerCounter = 0;
+
+    uint16 shiftRegister = 1;
+  };
+
+  struct dmc_channel_t {
+    bool enabled = false;
+    bool irqEnabled = false;
+    bool loop = false;
+
+    uint16 period = 0;
+    uint16 tickValue = 0;
+
+    // 7-bit value
+    uint8 value = 0;
+
+    uint16 address = 0;
+    uint16 length = 0;
+
+    uint16 sampleAddress = 0;
+    uint16 sampleLength = 0;
+
+    uint8 shiftRegister = 0;
+    uint8 bitCount = 0;
+  };
+
+  struct frame_counter_t {
+    uint8 resetShiftRegisterTicks;
+    uint16 shiftRegister;
+    bool interruptInhibit;
+    bool mode;
+    uint8 interruptFlag;
+  };
+
+  // The current output level of each channel
+  struct channel_output_t {
+    // 4-bit values
+    std::array<uint8_t, 2> pulse = {};
+    uint8_t triangle = 0;
+    uint8_t noise = 0;
+    // 7-bit value
+    uint8_t dmc = 0;
+
+    bool operator!=(const channel_output_t &other) const {
+      return pulse != other.pulse || triangle != other.triangle || noise != other.noise ||
+             dmc != other.dmc;
+    }
+  };
+
+  // How the channels' output is turned into samples
+  enum class synthesis_t {
+    // Every channel is mixed on every cycle, and the results are averaged for each sample
+    average,
+
+    // Band-limited steps are only added when the output level changes (less aliasing, and
+    // steady channels cost next to nothing)
+    blep,
+  };
+
+  // Reads a byte for the DMC channel
+  using dmc_read_t = uint8 (*)(void *context, uint16 address);
+
+  // Data
+  std::array<pulse_channel_t, 2> pulseChannels;
+  triangle_channel_t triangleChannel;
+  noise_channel_t noiseChannel;
+  dmc_channel_t dmcChannel;
+  frame_counter_t frameCounter;
+
+  bool isOddCycle;
+
+  dmc_read_t dmcRead = nullptr;
+  void *dmcReadContext = nullptr;
+
+  // Mixer
+  synthesis_t synthesis = synthesis_t::average;
+
+  double ticksPerSample = 0;
+  double elapsedCycles = 0;
+
+  // The mixed output level is only updated when a channel's output changes
+  channel_output_t lastOutput;
+  float outputLevel = 0;
+
+  // Used by synthesis_t::average
+  float sampleSum = 0;
+  uint32_t numSamples = 0;
+
+  // Used by synthesis_t::blep
+  // The steps are added to a ring buffer of differences, which is integrated as samples are output
+  double blepIntegrator = 0;
+  std::array<double, 32> blepBuffer = {};
+  size_t blepIndex = 0;
+
+  AudioOutput audioOutput;
+  size_t numBufferedSamples = 0;
+
+  // When cleared, the channels are still run (their state is observable through $4015 and IRQs),
+  // but they aren't mixed and no samples are output
+  bool isOutputEnabled = true;
+
+  // Public functions
+  void Power();
+
+  // Runs the APU for one CPU cycle
+  // Returns true when the frame counter raises an IRQ
+  [[nodiscard]] bool Tick();
+
+  // $4015
+  uint8 ReadStatus();
+
+  // $4000-$4013, $4015, $4017 (anything else is ignored)
+  void WriteRegister(uint16 address, uint8 value);
+
+  void SetAudioOutput(const AudioOutput &audioOutput, uint32_t sampleRate);
+  void FlushAudio();
+
+  // Changes the rate that samples are output at, without interrupting the output (e.g., to follow
+  // an audio device that consumes them slightly faster or slower than its nominal rate)
+  void SetSampleRate(double sampleRate);
+
+  // The audio output and the synthesis mode are settings, so they aren't part of the state
+  void Serialize(Serializer &serializer);
+
+  // Private functions
+  void quarterFrame();
+  void halfFrame();
+
+  channel_output_t channelOutput() const;
+  static float mix(const channel_output_t &output);
+
+  // Adds a band-limited step at the current position
+  void addBlepStep(double delta);
+  double readBlepSample();
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_APU_HPP_INCLUDED
@@ -13,6 +13,10 @@ struct Cartridge {
   // PRG-RAM or battery-backed save RAM
   std::array<uint8, 0x2000> workRam;
 
+  // The nametables at $2800 and $2c00 with four-screen mirroring (the PPU's own VRAM holds the
+  // other two)
+  std::array<uint8, 0x800> fourScreenVram;
+
   bool isNesV2 = false;
   uint8 prgRom16KUnits = 0;
   uint8 chrRom8KUnits = 0;
@@ -24,6 +28,11 @@ struct Cartridge {
   bool isBatteryBacked = false;
   bool hasTrainer = false;
 
+  // Incremented whenever the CHR data may have changed (CHR writes, and loading a ROM or a state),
+  // so that decoded tiles know when they're stale
+  // Bank switches don't need this, since the decoded tiles remember which data they came from
+  uint32_t chrGeneration = 1;
+
   // Public functions
   bool LoadRom(const void *romData, size_t romDataSize);
 
@@ -38,6 +47,9 @@ struct Cartridge {
   uint8 ReadCHR(uint16 address);
   void WriteCHR(uint16 address, uint8 value);
 
+  // Work RAM and the mapper's state
+  void Serialize(Serializer &serializer);
+
   // Private functions
 };
 
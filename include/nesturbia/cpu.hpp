@@ -1,14 +1,58 @@
 #ifndef NESTURBIA_CPU_HPP_INCLUDED
 #define NESTURBIA_CPU_HPP_INCLUDED
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 
+#include "nesturbia/apu.hpp"
 #include "nesturbia/types.hpp"
 
 namespace nesturbia {
 
-struct Cpu {
+// Bus that forwards the CPU's memory accesses to callbacks that are set at runtime
+// This is mainly useful for testing the CPU by itself
+struct CpuCallbackBus {
+  // Types
+  using read_callback_t = std::function<uint8(uint16)>;
+  using write_callback_t = std::function<void(uint16, uint8)>;
+  using tick_callback_t = std::function<void(void)>;
+
+  // Data
+  read_callback_t readCallback;
+  write_callback_t writeCallback;
+  tick_callback_t tickCallback;
+
+  // Public functions
+  uint8 Read(uint16 address) {
+    if (!readCallback) {
+      return 0;
+    }
+
+    return readCallback(address);
+  }
+
+  void Write(uint16 address, uint8 value) {
+    if (writeCallback) {
+      writeCallback(address, value);
+    }
+  }
+
+  void Tick() {
+    if (tickCallback) {
+      tickCallback();
+    }
+  }
+};
+
+// The CPU accesses the rest of the system through the bus given as a template parameter
+// The bus must provide the following functions:
+// * uint8 Read(uint16 address): read a value (without ticking)
+// * void Write(uint16 address, uint8 value): write a value (without ticking)
+// * void Tick(): called once per CPU cycle
+// Since the bus is known at compile time, these calls can be inlined into the CPU core
+template <typename Bus = CpuCallbackBus> struct Cpu {
   // Types
   struct flags_t {
     bool C = false;
@@ -32,133 +76,12 @@ struct Cpu {
     operator unsigned() const { return C << 0 | Z << 1 | I << 2 | D << 3 | V << 6 | N << 7; }
   };
 
-  struct length_counter_t {
-    // TODO halt isn't cleared on reset for triangle (keep in mind if implementing reset behavior)
-    bool halt = false;
-    // 5-bit value
-    uint8 value = 0;
-  };
-
-  struct envelope_t {
-    bool loop = false;
-    // Note: called 'constant volume' in some places
-    bool disabled = false;
-    // 4-bit value
-    uint8 volume = 0;
-    // 4-bit value
-    uint8 divider = 0;
-    // 4-bit value
-    uint8 count = 0;
-    bool reload = false;
-  };
-
-  struct pulse_channel_t {
-    bool enabled = false;
-
-    // 2-bit value
-    uint8 duty = 0;
-    // 3-bit value, wraps around
-    uint8 dutyIndex = 0;
-
-    length_counter_t length;
-    envelope_t envelope;
-
-    struct {
-      bool enabled = false;
-      // 3-bit value
-      uint8 period = 0;
-      // 3-bit value
-      uint8 divider = 0;
-      bool negate = false;
-      uint8 shiftAmount = 0;
-      bool reload = false;
-    } sweep;
-
-    // 11-bit value
-    uint16 period;
-
-    // 11-bit value
-    // TODO where to initialize (other than here obviously)?
-    uint16 timerCounter = 0;
-  };
-
-  struct triangle_channel_t {
-    bool enabled = false;
-
-    length_counter_t length;
+  // The devices that can raise an IRQ, as bits of `irq`
+  enum class irq_source_t : uint8_t { apu = 1U << 0, cartridge = 1U << 1 };
 
-    // 5-bit value, wraps around
-    uint8 dutyIndex = 0;
-
-    struct {
-      bool control;
-      // 7-bit value
-      uint8 load = 0;
-      // 7-bit value
-      uint8 value = 0;
-      bool reload = false;
-    } linearCounter;
-
-    // 11-bit value
-    uint16 period;
-
-    // 11-bit value
-    // TODO where to initialize (other than here obviously)?
-    uint16 timerCounter = 0;
-  };
-
-  struct noise_channel_t {
-    bool enabled = false;
-
-    // Bit 7 of $400e
-    bool mode = false;
-
-    length_counter_t length;
-    envelope_t envelope;
-
-    // 12-bit value
-    uint16 period = 0;
-
-    // 12-bit value
-    // TODO where to initialize (other than here obviously)?
-    uint16 timerCounter = 0;
-
-    uint16 shiftRegister = 1;
-  };
-
-  struct dmc_channel_t {
-    bool enabled = false;
-    bool irqEnabled = false;
-    bool loop = false;
-
-    uint16 period = 0;
-    uint16 tickValue = 0;
-
-    // 7-bit value
-    uint8 value = 0;
-
-    uint16 address = 0;
-    uint16 length = 0;
-
-    uint16 sampleAddress = 0;
-    uint16 sampleLength = 0;
-
-    uint8 shiftRegister = 0;
-    uint8 bitCount = 0;
-  };
-
-  struct frame_counter_t {
-    uint8 resetShiftRegisterTicks;
-    uint16 shiftRegister;
-    bool interruptInhibit;
-    bool mode;
-    uint8 interruptFlag;
-  };
-
-  using read_callback_t = std::function<uint8(uint16)>;
-  using write_callback_t = std::function<void(uint16, uint8)>;
-  using tick_callback_t = std::function<void(void)>;
-  using sample_callback_t = void (*)(float);
+  using read_callback_t = CpuCallbackBus::read_callback_t;
+  using write_callback_t = CpuCallbackBus::write_callback_t;
+  using tick_callback_t = CpuCallbackBus::tick_callback_t;
 
   // Data
   uint8 A;
@@ -168,36 +91,35 @@ struct Cpu {
   uint16 PC;
   flags_t P;
 
-  read_callback_t readCallback;
-  write_callback_t writeCallback;
-  tick_callback_t tickCallback;
-  sample_callback_t sampleCallback = nullptr;
+  Bus bus;
 
   uint32_t cycles;
+  uint32_t instructions;
 
   bool nmi;
-  bool irq;
-
-  // APU-specific
-  double ticksPerSample = 0;
 
-  std::array<pulse_channel_t, 2> pulseChannels;
-  triangle_channel_t triangleChannel;
-  noise_channel_t noiseChannel;
-  dmc_channel_t dmcChannel;
-  frame_counter_t frameCounter;
+  // The sources of the pending IRQ (see irq_source_t), which are all cleared when it's taken
+  uint8_t irq;
 
-  bool isOddCycle;
+  // Ticked along with the CPU
+  Apu apu;
 
   // Public functions
+  explicit Cpu(Bus bus);
+
+  // Only available when using CpuCallbackBus
   Cpu(read_callback_t readCallback, write_callback_t writeCallback, tick_callback_t tickCallback);
 
   void Power();
   void Reset();
   void NMI();
-  void IRQ();
+  void IRQ(irq_source_t source);
+
+  // Withdraws the IRQ of `source` if it's still pending, e.g. when the game acknowledges it while
+  // interrupts are disabled
+  void AcknowledgeIRQ(irq_source_t source);
 
-  void SetSampleCallback(sample_callback_t sampleCallback, uint32_t sampleRate);
+  void Serialize(Serializer &serializer);
 
   // Private functions
   uint8 read(uint16 address);
@@ -215,10 +137,14 @@ struct Cpu {
   void tick();
   void executeInstruction();
 
-  void apuQuarterFrame();
-  void apuHalfFrame();
+  // Handed to the APU so that the DMC channel can read samples through the bus
+  static uint8 dmcRead(void *context, uint16 address);
 };
 
+template <>
+Cpu<CpuCallbackBus>::Cpu(read_callback_t readCallback, write_callback_t writeCallback,
+                         tick_callback_t tickCallback);
+
 } // namespace nesturbia
 
 #endif // NESTURBIA_CPU_HPP_INCLUDED
@@ -27,6 +27,7 @@ struct Joypad {
 
   // Public functions
   void SetInput(const input_t &input);
+  [[nodiscard]] input_t GetInput() const;
   uint8 Read();
   void Strobe(bool strobe);
 };
@@ -1,9 +1,12 @@
 #ifndef NESTURBIA_MAPPER_HPP_INCLUDED
 #define NESTURBIA_MAPPER_HPP_INCLUDED
 
+#include <array>
+#include <cstddef>
 #include <memory>
 #include <string>
 
+#include "nesturbia/serializer.hpp"
 #include "nesturbia/types.hpp"
 
 namespace nesturbia {
@@ -12,10 +15,44 @@ struct Mapper {
   // Types
   using ptr_t = std::unique_ptr<Mapper>;
 
-  // TODO: needs a 4-way type?
-  enum class mirror_t { horizontal, vertical, oneScreenLower, oneScreenHigher };
+  // fourScreen: the cartridge has 2K of VRAM of its own, so each nametable has its own memory
+  enum class mirror_t { horizontal, vertical, oneScreenLower, oneScreenHigher, fourScreen };
+
+  // Data
+  // The 8K PRG-ROM banks that are currently mapped to $8000, $a000, $c000 and $e000
+  // Mappers must keep these up to date whenever they switch banks, since the CPU reads PRG-ROM
+  // through them directly (a null bank is read through ReadPRG() instead)
+  std::array<const uint8 *, 4> prgBanks = {};
+
+  // The 1K CHR banks that are currently mapped to $0000-$1fff, and the ones among them that are
+  // writable (CHR-RAM)
+  // Like prgBanks, mappers must keep these up to date, since the PPU accesses CHR through them
+  // directly (a null bank is accessed through ReadCHR()/WriteCHR() instead)
+  std::array<const uint8 *, 8> chrBanks = {};
+  std::array<uint8 *, 8> chrWriteBanks = {};
+
+  // Whether the work RAM at $6000-$7fff is enabled, and whether it can be written to
+  // Mappers that can disable or write-protect it must keep these up to date, like prgBanks
+  bool isWorkRamEnabled = true;
+  bool isWorkRamWritable = true;
+
+  // Set by mappers that react to the addresses of the PPU's CHR accesses (see ObservePpuAddress())
+  bool observesPpuAddress = false;
+
+  // Set by mappers that count scanlines by the rising edges of the PPU's A12 line (e.g., MMC3)
+  // Rather than watching every CHR access for that, the PPU works out from its registers on which
+  // dot of each rendered line A12 rises, and calls ClockScanline() on it
+  bool countsScanlines = false;
+
+  // Whether the mapper's IRQ is asserted, i.e. raised and not yet acknowledged by the game
+  // Mappers that raise IRQs must keep this up to date, since an IRQ that the CPU hasn't taken yet
+  // is withdrawn when a mapper write clears it
+  bool isIrqAsserted = false;
 
   // Public functions
+  // Mappers are owned (and destroyed) through ptr_t
+  virtual ~Mapper() = default;
+
   [[nodiscard]] virtual mirror_t GetMirrorType() const = 0;
 
   virtual uint8 ReadPRG(uint16 address) = 0;
@@ -23,6 +60,44 @@ struct Mapper {
 
   virtual uint8 ReadCHR(uint16 address) = 0;
   virtual void WriteCHR(uint16 address, uint8 value) = 0;
+
+  // Called with the address of every CHR access that the PPU makes (pattern fetches and PPUDATA)
+  // if observesPpuAddress is set, for mappers that watch the PPU's address lines (e.g., MMC2's
+  // latches)
+  // Returns whether the CHR banks were switched, in which case the PPU picks up the new ones
+  virtual bool ObservePpuAddress(uint16 address) {
+    (void)address;
+    return false;
+  }
+
+  // Clocks the scanline counter (if countsScanlines is set), and returns whether that raises an IRQ
+  virtual bool ClockScanline() { return false; }
+
+  // The number of ClockScanline() calls until one of them raises an IRQ (0 if none will)
+  // The PPU makes that clock an event, so that the IRQ happens on time while it runs behind the CPU
+  [[nodiscard]] virtual uint32_t ScanlinesUntilIrq() const { return 0; }
+
+  // Saves/loads the bank registers and CHR-RAM (ROM isn't part of the state)
+  // Mappers must update their banks after loading
+  virtual void Serialize(Serializer &serializer) { (void)serializer; }
+
+  // Private functions
+  // Maps `size` bytes (a multiple of 8K) of `prg` to the PRG-ROM banks from `address` onwards
+  void mapPrg(uint16_t address, size_t size, const uint8 *prg) {
+    for (size_t offset = 0; offset < size; offset += 0x2000) {
+      prgBanks[((address + offset) >> 13) & 0x3] = prg + offset;
+    }
+  }
+
+  // Maps `size` bytes (a multiple of 1K) of `chr` to the CHR banks from `address` onwards, which
+  // are writable as well if `isRam` is set
+  void mapChr(uint16_t address, size_t size, uint8 *chr, bool isRam) {
+    for (size_t offset = 0; offset < size; offset += 0x400) {
+      const auto bank = ((address + offset) >> 10) & 0x7;
+      chrBanks[bank] = chr + offset;
+      chrWriteBanks[bank] = isRam ? chr + offset : nullptr;
+    }
+  }
 };
 
 } // namespace nesturbia
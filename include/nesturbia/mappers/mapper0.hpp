@@ -26,6 +26,8 @@ struct Mapper0 : public Mapper {
 
   uint8 ReadCHR(uint16 address) override;
   void WriteCHR(uint16 address, uint8 value) override;
+
+  void Serialize(Serializer &serializer) override;
 };
 
 } // namespace nesturbia
@@ -1,6 +1,7 @@
 #ifndef NESTURBIA_MAPPERS_MAPPER_1_HPP_INCLUDED
 #define NESTURBIA_MAPPERS_MAPPER_1_HPP_INCLUDED
 
+#include <array>
 #include <vector>
 
 #include "nesturbia/mapper.hpp"
@@ -38,7 +39,8 @@ struct Mapper1 : public Mapper {
   // * CHR0 bank: internal register at $a000-$bfff
   // * CHR1 bank: internal register at $c000-$dfff
   // 5-bit values
-  std::array<uint8, 2> chrBankRegisters;
+  // In 8K mode, CHR0 selects an 8K bank (its bottom bit is ignored) and CHR1 is unused
+  std::array<uint8, 2> chrBankRegisters = {};
 
   // PRG bank register: internal register at $e000-$ffff
   struct {
@@ -60,6 +62,12 @@ struct Mapper1 : public Mapper {
 
   uint8 ReadCHR(uint16 address) override;
   void WriteCHR(uint16 address, uint8 value) override;
+
+  void Serialize(Serializer &serializer) override;
+
+  // Private functions
+  void updatePrgBanks();
+  void updateChrBanks();
 };
 
 } // namespace nesturbia
@@ -0,0 +1,40 @@
+#ifndef NESTURBIA_MAPPERS_MAPPER_2_HPP_INCLUDED
+#define NESTURBIA_MAPPERS_MAPPER_2_HPP_INCLUDED
+
+#include <vector>
+
+#include "nesturbia/mapper.hpp"
+
+namespace nesturbia {
+
+// Mapper 2: aka UxROM (includes UNROM and UOROM)
+// A switchable 16K PRG-ROM bank at $8000, and the last one fixed at $c000
+struct Mapper2 : public Mapper {
+  // Data
+  std::vector<uint8> prgRom;
+  std::vector<uint8> chrRom;
+  std::vector<uint8> chrRam;
+  uint8 prgBank = 0;
+  mirror_t mirrorType;
+
+  // Public functions
+  static Mapper::ptr_t Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom,
+                              mirror_t mirrorType);
+
+  [[nodiscard]] mirror_t GetMirrorType() const override;
+
+  uint8 ReadPRG(uint16 address) override;
+  void WritePRG(uint16 address, uint8 value) override;
+
+  uint8 ReadCHR(uint16 address) override;
+  void WriteCHR(uint16 address, uint8 value) override;
+
+  void Serialize(Serializer &serializer) override;
+
+  // Private functions
+  void updatePrgBanks();
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_MAPPERS_MAPPER_2_HPP_INCLUDED
@@ -8,7 +8,6 @@
 namespace nesturbia {
 
 // Mapper 3: aka CNROM
-// TODO: could this have CHR-RAM?
 struct Mapper3 : public Mapper {
   // Data
   std::vector<uint8> prgRom;
@@ -27,6 +26,11 @@ struct Mapper3 : public Mapper {
 
   uint8 ReadCHR(uint16 address) override;
   void WriteCHR(uint16 address, uint8 value) override;
+
+  void Serialize(Serializer &serializer) override;
+
+  // Private functions
+  void updateChrBanks();
 };
 
 } // namespace nesturbia
@@ -1,6 +1,7 @@
 #ifndef NESTURBIA_MAPPERS_MAPPER_4_HPP_INCLUDED
 #define NESTURBIA_MAPPERS_MAPPER_4_HPP_INCLUDED
 
+#include <array>
 #include <vector>
 
 #include "nesturbia/mapper.hpp"
@@ -8,11 +9,53 @@
 namespace nesturbia {
 
 // Mapper 4: aka TxROM / MMC3
-// TODO: has optional PRG-RAM at 0x6000-0x7fff
 struct Mapper4 : public Mapper {
   // Data
+  std::vector<uint8> prgRom;
+  std::vector<uint8> chrRom;
+  std::vector<uint8> chrRam;
+
+  // Bank select: internal register at $8000-$9ffe (even)
+  struct {
+    // The bank register that the next bank data write goes to (bits 2 to 0)
+    // 3-bit value
+    uint8 bankRegister = 0;
+
+    // PRG-ROM bank mode (bit 6): swaps the banks at $8000 and $c000
+    bool prgRomBankMode = false;
+
+    // CHR A12 inversion (bit 7): swaps the pattern tables
+    bool chrA12Inversion = false;
+  } bankSelectRegister;
+
+  // Bank data: internal registers at $8001-$9fff (odd)
+  // * R0, R1: 2K CHR banks at $0000 and $0800 (the bottom bit is ignored)
+  // * R2-R5: 1K CHR banks at $1000, $1400, $1800 and $1c00
+  // * R6, R7: 8K PRG-ROM banks at $8000 and $a000
+  // The pattern tables are swapped with CHR A12 inversion, and $8000 and $c000 with the PRG-ROM
+  // bank mode
+  std::array<uint8, 8> bankRegisters = {};
+
+  // Mirroring: internal register at $a000-$bffe (even)
   mirror_t mirrorType;
 
+  // PRG-RAM protect: internal register at $a001-$bfff (odd)
+  struct {
+    // Bit 6
+    bool denyWrites = false;
+
+    // Bit 7
+    bool chipEnable = true;
+  } prgRamProtectRegister;
+
+  // Scanline counter
+  // The counter is reloaded from the latch when it's clocked at zero (or after a reload request),
+  // and is decremented otherwise; an IRQ is raised when it's zero after being clocked
+  uint8 irqLatch = 0;
+  uint8 irqCounter = 0;
+  bool irqReload = false;
+  bool irqEnabled = false;
+
   // Public functions
   static Mapper::ptr_t Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom,
                               mirror_t mirrorType);
@@ -24,6 +67,15 @@ struct Mapper4 : public Mapper {
 
   uint8 ReadCHR(uint16 address) override;
   void WriteCHR(uint16 address, uint8 value) override;
+
+  bool ClockScanline() override;
+  [[nodiscard]] uint32_t ScanlinesUntilIrq() const override;
+
+  void Serialize(Serializer &serializer) override;
+
+  // Private functions
+  void updatePrgBanks();
+  void updateChrBanks();
 };
 
 } // namespace nesturbia
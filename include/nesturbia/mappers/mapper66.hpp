@@ -0,0 +1,51 @@
+#ifndef NESTURBIA_MAPPERS_MAPPER_66_HPP_INCLUDED
+#define NESTURBIA_MAPPERS_MAPPER_66_HPP_INCLUDED
+
+#include <vector>
+
+#include "nesturbia/mapper.hpp"
+
+namespace nesturbia {
+
+// Mapper 66: aka GxROM (includes GNROM and MHROM)
+// A switchable 32K PRG-ROM bank and 8K CHR bank, which are both selected by one register
+struct Mapper66 : public Mapper {
+  // Data
+  std::vector<uint8> prgRom;
+  std::vector<uint8> chrRom;
+  std::vector<uint8> chrRam;
+
+  // Bank select register at $8000-$ffff
+  struct {
+    // PRG-ROM bank (bits 5 and 4)
+    // 2-bit value
+    uint8 prgRomBank = 0;
+
+    // CHR bank (bits 1 and 0)
+    // 2-bit value
+    uint8 chrBank = 0;
+  } bankRegister;
+
+  mirror_t mirrorType;
+
+  // Public functions
+  static Mapper::ptr_t Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom,
+                              mirror_t mirrorType);
+
+  [[nodiscard]] mirror_t GetMirrorType() const override;
+
+  uint8 ReadPRG(uint16 address) override;
+  void WritePRG(uint16 address, uint8 value) override;
+
+  uint8 ReadCHR(uint16 address) override;
+  void WriteCHR(uint16 address, uint8 value) override;
+
+  void Serialize(Serializer &serializer) override;
+
+  // Private functions
+  void updateBanks();
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_MAPPERS_MAPPER_66_HPP_INCLUDED
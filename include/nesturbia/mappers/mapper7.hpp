@@ -0,0 +1,47 @@
+#ifndef NESTURBIA_MAPPERS_MAPPER_7_HPP_INCLUDED
+#define NESTURBIA_MAPPERS_MAPPER_7_HPP_INCLUDED
+
+#include <vector>
+
+#include "nesturbia/mapper.hpp"
+
+namespace nesturbia {
+
+// Mapper 7: aka AxROM (includes ANROM, AOROM, etc.)
+// A switchable 32K PRG-ROM bank, and one-screen mirroring that selects its nametable
+struct Mapper7 : public Mapper {
+  // Data
+  std::vector<uint8> prgRom;
+  std::vector<uint8> chrRom;
+  std::vector<uint8> chrRam;
+
+  // Bank select register at $8000-$ffff
+  struct {
+    // PRG-ROM bank (bits 2 to 0)
+    // 3-bit value
+    uint8 prgRomBank = 0;
+
+    // Nametable select (bit 4)
+    bool nametable = false;
+  } bankRegister;
+
+  // Public functions
+  static Mapper::ptr_t Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom);
+
+  [[nodiscard]] mirror_t GetMirrorType() const override;
+
+  uint8 ReadPRG(uint16 address) override;
+  void WritePRG(uint16 address, uint8 value) override;
+
+  uint8 ReadCHR(uint16 address) override;
+  void WriteCHR(uint16 address, uint8 value) override;
+
+  void Serialize(Serializer &serializer) override;
+
+  // Private functions
+  void updatePrgBanks();
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_MAPPERS_MAPPER_7_HPP_INCLUDED
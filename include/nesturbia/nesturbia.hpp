@@ -2,40 +2,232 @@
 #define NESTURBIA_NESTURBIA_HPP_INCLUDED
 
 #include <array>
+#include <cassert>
 #include <string>
+#include <vector>
 
 #include "nesturbia/cartridge.hpp"
 #include "nesturbia/cpu.hpp"
 #include "nesturbia/joypad.hpp"
 #include "nesturbia/mapper.hpp"
 #include "nesturbia/ppu.hpp"
+#include "nesturbia/rewind.hpp"
 #include "nesturbia/types.hpp"
 
 namespace nesturbia {
 
+// What Nesturbia::RunFrame() outputs
+// Frames that are never shown or heard (e.g., when fast-forwarding) can skip either one, which
+// makes them much cheaper to run; everything that the game can observe stays exactly the same
+struct FrameOutput {
+  // Data
+  // Drawing Ppu::pixels
+  bool video = true;
+
+  // Mixing samples for the audio output
+  bool audio = true;
+};
+
 struct Nesturbia {
+  // Constants
+  // Bumped whenever the layout of the state changes
+  static inline constexpr uint32_t kStateVersion = 3;
+
+  // Types
+  // The bus that the CPU uses to access the rest of the system
+  // Its functions (and the functions that they call) are defined inline below so that they can
+  // be inlined into the CPU core
+  struct cpu_bus_t {
+    Nesturbia &emulator;
+
+    uint8 Read(uint16 address);
+    void Write(uint16 address, uint8 value);
+    void Tick();
+  };
+
+  using cpu_t = Cpu<cpu_bus_t>;
+
   // Data
   Cartridge cartridge;
-  Cpu cpu;
+  cpu_t cpu;
   Ppu ppu;
   std::array<Joypad, 2> joypads;
   std::array<uint8, 0x800> ram;
 
   bool isNewFrame;
 
+  // The CPU's address space, in 256-byte pages
+  // Pages backed by plain memory (RAM, work RAM and PRG-ROM) point directly at it so that they can
+  // be accessed with a single load/store; everything else (null pages) goes through the slow path
+  std::array<const uint8 *, 0x100> cpuReadPages = {};
+  std::array<uint8 *, 0x100> cpuWritePages = {};
+
+  // The PPU isn't ticked in lockstep with the CPU; it's caught up ("synced") only when accessed,
+  // or when it reaches an event that's observable outside of it (see Ppu::DotsUntilNextEvent())
+  // These are the number of dots that the PPU is behind the CPU, and the number of dots until the
+  // next event (at which point the PPU must be synced)
+  uint32_t ppuPendingDots = 0;
+  uint32_t ppuDotsUntilEvent = 0;
+
+  // The state is captured here after every frame while rewinding is enabled
+  RewindBuffer rewindBuffer;
+  size_t rewindBufferSize = 0;
+  std::vector<uint8_t> rewindState;
+
+  // The real state is kept here while running ahead
+  uint32_t runAheadFrames = 0;
+  std::vector<uint8_t> runAheadState;
+
   // Public functions
   Nesturbia();
-  void SetAudioSampleCallback(Cpu::sample_callback_t sampleCallback, uint32_t sampleRate);
+  void SetAudioOutput(const AudioOutput &audioOutput, uint32_t sampleRate);
+
+  // Fine-tunes the sample rate set by SetAudioOutput() (see Apu::SetSampleRate())
+  void SetAudioSampleRate(double sampleRate);
+
   bool LoadRom(const void *romData, size_t romDataSize);
   bool LoadBatteryBackedRam(const void *ramData, size_t ramDataSize);
-  void RunFrame(const Joypad::input_t &joypadInput1 = {}, const Joypad::input_t &joypadInput2 = {});
+  void RunFrame(const Joypad::input_t &joypadInput1 = {}, const Joypad::input_t &joypadInput2 = {},
+                const FrameOutput &output = {});
+
+  // Save states
+  // The state of the whole machine is a flat, versioned blob of StateSize() bytes
+  // Saving and loading don't allocate, and a state can only be loaded into an emulator with the
+  // same ROM loaded
+  [[nodiscard]] size_t StateSize();
+  bool SaveState(void *data, size_t dataSize);
+  bool LoadState(const void *data, size_t dataSize);
+
+  // Rewinding
+  // While enabled, the state is captured after every frame, in at most `bufferSize` bytes (0
+  // disables rewinding)
+  void EnableRewind(size_t bufferSize);
+
+  // Goes back one frame
+  // The frame before it is run again (with the same input), so that the video and audio output
+  // match the frame that was rewound to
+  bool RewindFrame();
+
+  // Run-ahead
+  // Hides the game's own input lag: each frame is followed by `frames` more frames with the same
+  // input, the last of which is what ends up in Ppu::pixels; then the state is restored, so that
+  // only the first frame really happened (and only its audio is output)
+  // The frames in between don't output anything
+  // 0 disables running ahead
+  void SetRunAhead(uint32_t frames);
 
   // Private functions
+  void runFrame(const Joypad::input_t &joypadInput1, const Joypad::input_t &joypadInput2);
   uint8 cpuReadCallback(uint16 address);
   void cpuWriteCallback(uint16 address, uint8 value);
   void cpuTickCallback();
+  void oamDma(uint8 page);
+  void serialize(Serializer &serializer);
+  void updatePrgPages();
+  void syncPpu();
+  void schedulePpu();
 };
 
+inline uint8 Nesturbia::cpu_bus_t::Read(uint16 address) {
+  return emulator.cpuReadCallback(address);
+}
+
+inline void Nesturbia::cpu_bus_t::Write(uint16 address, uint8 value) {
+  emulator.cpuWriteCallback(address, value);
+}
+
+inline void Nesturbia::cpu_bus_t::Tick() { emulator.cpuTickCallback(); }
+
+inline uint8 Nesturbia::cpuReadCallback(uint16 address) {
+  if (const auto *page = cpuReadPages[address >> 8]) {
+    // RAM, work RAM or PRG-ROM
+    return page[address & 0xff];
+  }
+
+  // TODO read from joypad 1 (zero-indexed, the second one)
+  if (address < 0x4000) {
+    // PPU registers (and their mirrors)
+    syncPpu();
+    return ppu.ReadRegister(address);
+  } else if (address < 0x4016) {
+    // APU register (handled internally)
+    assert(0);
+    return 0;
+  } else if (address == 0x4016) {
+    return joypads[0].Read();
+  } else if (address == 0x4017) {
+    // TODO: handle 2nd joystick
+    return 0;
+  } else if (address < 0x4020) {
+    // APU register (handled internally)
+    assert(0);
+    return 0;
+  } else {
+    return cartridge.ReadPRG(address);
+  }
+}
+
+inline void Nesturbia::cpuWriteCallback(uint16 address, uint8 value) {
+  if (auto *page = cpuWritePages[address >> 8]) {
+    // RAM or work RAM
+    page[address & 0xff] = value;
+    return;
+  }
+
+  if (address < 0x4000) {
+    // PPU registers (and their mirrors)
+    // Writes can change when the PPU's next event occurs (e.g., enabling NMIs or rendering)
+    syncPpu();
+    ppu.WriteRegister(address, value);
+    schedulePpu();
+  } else if (address < 0x4014) {
+    // APU registers (handled internally)
+    assert(0);
+  } else if (address == 0x4014) {
+    oamDma(value);
+  } else if (address == 0x4015) {
+    // APU register (handled internally)
+    assert(0);
+  } else if (address == 0x4016) {
+    // Joypad strobes
+    joypads[0].Strobe(value.bit(0));
+    joypads[1].Strobe(value.bit(0));
+  } else if (address < 0x4020) {
+    // APU register (handled internally)
+    assert(0);
+  } else {
+    // Mapper registers can change what the PPU renders (e.g., CHR banks and mirroring)
+    if (address >= 0x8000) {
+      syncPpu();
+    }
+
+    cartridge.WritePRG(address, value);
+
+    if (address >= 0x8000) {
+      // The mapper may have switched PRG/CHR banks or changed the mirroring, and its IRQ may be
+      // due at a different time
+      updatePrgPages();
+      ppu.UpdateNametables();
+      ppu.UpdateChrPages();
+      schedulePpu();
+
+      // The game may have acknowledged the mapper's IRQ before the CPU took it
+      if (cartridge.mapper && !cartridge.mapper->isIrqAsserted) {
+        cpu.AcknowledgeIRQ(cpu_t::irq_source_t::cartridge);
+      }
+    }
+  }
+}
+
+inline void Nesturbia::cpuTickCallback() {
+  // Each CPU tick results in 3 PPU ticks
+  // Only run them once the PPU's next event is reached; until then they are caught up on demand
+  ppuPendingDots += 3;
+  if (ppuPendingDots >= ppuDotsUntilEvent) {
+    syncPpu();
+  }
+}
+
 } // namespace nesturbia
 
 #endif // NESTURBIA_NESTURBIA_HPP_INCLUDED
@@ -0,0 +1,63 @@
+#ifndef NESTURBIA_PALETTE_HPP_INCLUDED
+#define NESTURBIA_PALETTE_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace nesturbia {
+
+// Turns the PPU's palette indexes into colors
+// A palette index is the 6-bit color from palette RAM (bits 0-5), plus PPUMASK's emphasis bits
+// (bit 6: red, bit 7: green, bit 8: blue)
+struct Palette {
+  // Constants
+  static inline constexpr auto kNumColors = 512U;
+
+  // Types
+  // The layout of converted pixels, in memory order
+  enum class format_t {
+    // 3 bytes per pixel
+    rgb,
+
+    // 4 bytes per pixel (alpha is always 255)
+    rgba,
+    bgra,
+  };
+
+  // The instructions that ConvertFrame() uses
+  enum class instruction_set_t {
+    scalar,
+    sse2,
+
+    // Only used if the CPU supports it (see BestInstructionSet())
+    avx2,
+  };
+
+  // Data
+  // 0xRRGGBB for every palette index
+  std::array<uint32_t, kNumColors> colors;
+
+  instruction_set_t instructionSet = BestInstructionSet();
+
+  // Public functions
+  // Uses the default palette, with emphasis darkening the other color components
+  Palette();
+
+  // Converts `numPixels` palette indexes to `format`
+  void Convert(const uint16_t *indexes, size_t numPixels, format_t format, uint8_t *output) const;
+
+  // Converts a frame of `width` x `height` palette indexes (e.g., Ppu::indexedPixels) to 32-bit
+  // pixels (`format` must be rgba or bgra), scaled up by `scale` in both directions
+  // `output` must have room for (width * scale) x (height * scale) pixels
+  // Scales of 1 to 3 are vectorized; higher ones fall back to scalar code
+  void ConvertFrame(const uint16_t *indexes, size_t width, size_t height, format_t format,
+                    uint32_t scale, uint32_t *output) const;
+
+  // The fastest instruction set that this CPU supports
+  [[nodiscard]] static instruction_set_t BestInstructionSet();
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_PALETTE_HPP_INCLUDED
@@ -5,6 +5,8 @@
 #include <functional>
 
 #include "nesturbia/cartridge.hpp"
+#include "nesturbia/palette.hpp"
+#include "nesturbia/serializer.hpp"
 #include "nesturbia/types.hpp"
 
 namespace nesturbia {
@@ -49,14 +51,14 @@ struct Ppu {
   };
 
   struct ppumask_t {
-    bool grayscale;
-    bool showBackgroundInLeftmost8Px;
-    bool showSpritesInLeftmost8Px;
-    bool showBackground;
-    bool showSprites;
-    bool emphasizeRed;
-    bool emphasizeGreen;
-    bool emphasizeBlue;
+    bool grayscale = false;
+    bool showBackgroundInLeftmost8Px = false;
+    bool showSpritesInLeftmost8Px = false;
+    bool showBackground = false;
+    bool showSprites = false;
+    bool emphasizeRed = false;
+    bool emphasizeGreen = false;
+    bool emphasizeBlue = false;
 
     auto &operator=(uint8 value) {
       grayscale = value.bit(0);
@@ -104,11 +106,49 @@ struct Ppu {
     uint8 y;
     uint8 tile;
     uint8 attributes;
-    uint8 dataL;
-    uint8 dataH;
+
+    // The decoded pixels of the sprite's row on the current line, already flipped horizontally if
+    // needed
+    std::array<uint8_t, 8> pixels;
+  };
+
+  // A tile from a pattern table, decoded into one 2-bit pattern index per pixel
+  struct decoded_tile_t {
+    // The CHR data that the tile was decoded from (in its page), and the value of
+    // Cartridge::chrGeneration at the time
+    const uint8 *data;
+    uint32_t chrGeneration;
+
+    // Indexed by [row][x]
+    std::array<std::array<uint8_t, 8>, 8> pixels;
+
+    // The same pixels, but flipped horizontally (for sprites)
+    std::array<std::array<uint8_t, 8>, 8> flippedPixels;
+  };
+
+  // Which renderer is used by Run()
+  enum class renderer_t {
+    // Every dot is run through Tick()
+    dot,
+
+    // Visible lines are drawn all at once when nothing can access the PPU midway through them
+    // Otherwise, this falls back to the dot renderer, so the output is the same
+    scanline,
+  };
+
+  // How the frame is output
+  enum class pixel_format_t {
+    // `pixels`: 3 bytes (R, G, B) per pixel
+    rgb,
+
+    // `indexedPixels`: one palette index (see Palette) per pixel, which the frontend converts to
+    // colors only when it needs them (e.g., with Palette::Convert())
+    // This writes a third of the data, and grayscale and emphasis come for free
+    indexed,
   };
 
   using nmi_callback_t = std::function<void(void)>;
+  using irq_callback_t = std::function<void(void)>;
 
   // Data
   // Cartridge reference
@@ -141,6 +181,24 @@ struct Ppu {
   // Nametable memory
   std::array<uint8, 0x800> vram;
 
+  // The 1K nametables at $2000, $2400, $2800 and $2c00 ($3000-$3eff are mirrors of them), which
+  // point into `vram` (or the cartridge's VRAM) according to the cartridge's mirroring
+  // These must be updated whenever the mirroring may have changed (see UpdateNametables()), which
+  // makes every nametable access a single indexed load
+  std::array<uint8 *, 4> nametables;
+
+  // The 1K pattern table pages at $0000-$1fff (and the writable ones among them), which are the
+  // mapper's current CHR banks (see UpdateChrPages())
+  // A null page is accessed through the cartridge instead
+  std::array<const uint8 *, 8> chrReadPages = {};
+  std::array<uint8 *, 8> chrWritePages = {};
+
+  // The mapper, if it watches the addresses of CHR accesses (see Mapper::ObservePpuAddress())
+  Mapper *ppuAddressObserver = nullptr;
+
+  // The mapper, if it counts scanlines (see Mapper::ClockScanline())
+  Mapper *scanlineCounter = nullptr;
+
   // OAM memory
   std::array<uint8, 0x100> oam;
   std::array<oam_entry_t, 8> oamPrimary;
@@ -149,26 +207,81 @@ struct Ppu {
   // Palette memory
   std::array<uint8, 0x20> paletteRam;
 
+  // Decoded tiles of both pattern tables ($0000-$1fff), indexed by (address / 16)
+  // These are decoded when they're first used after the CHR data may have changed, or after their
+  // page was switched to another bank (so switching some banks keeps the tiles of the others)
+  std::array<decoded_tile_t, 0x200> tileCache = {};
+
   // Pixel memory
+  // Only the one that matches `pixelFormat` is drawn to
   std::array<uint8, kScreenWidth * kScreenHeight * 3> pixels;
+  std::array<uint16_t, kScreenWidth * kScreenHeight> indexedPixels;
+
+  pixel_format_t pixelFormat = pixel_format_t::rgb;
+
+  // The colors that are used for `pixels`
+  Palette palette;
 
   // Function that's called when an NMI is encountered
   // This is called when VBLANK occurs, and the appropriate bit (7) is set in PPUCTRL
   nmi_callback_t nmiCallback;
 
+  // Function that's called when the mapper's scanline counter raises an IRQ
+  irq_callback_t irqCallback;
+
   // TODO temporary
   render_data_t renderData;
 
+  renderer_t renderer = renderer_t::dot;
+
+  // When cleared, nothing is drawn to `pixels`, which makes running frames that are never shown
+  // much cheaper
+  // Everything that the CPU can observe (e.g., sprite 0 hits) behaves the same either way
+  bool isOutputEnabled = true;
+
   // Public functions
-  Ppu(Cartridge &cartridge, nmi_callback_t nmiCallback);
+  Ppu(Cartridge &cartridge, nmi_callback_t nmiCallback, irq_callback_t irqCallback = {});
 
   void Power();
   bool Tick();
+  bool Run(uint32_t dots);
+  [[nodiscard]] uint32_t DotsUntilNextEvent() const;
   uint8 ReadRegister(uint16 address);
   void WriteRegister(uint16 address, uint8 value);
 
+  // OAM DMA: the same as writing the 256 bytes of `data` to OAMDATA, in one go
+  void WriteOamDma(const uint8 *data);
+
+  // Points the nametables at the VRAM that the cartridge's current mirroring selects
+  void UpdateNametables();
+
+  // Points the pattern table pages at the mapper's current CHR banks (and picks up whether the
+  // mapper watches the PPU's addresses)
+  void UpdateChrPages();
+
+  // The pixels (of either format) and the tile cache are derived from the rest of the state, so
+  // they aren't saved (the tile cache is invalidated by bumping Cartridge::chrGeneration after
+  // loading)
+  void Serialize(Serializer &serializer);
+
   // Private functions
   uint8 read(uint16 address);
+  [[nodiscard]] uint8 readChr(uint16 address) const;
+  void observeChrAccess(uint16 address);
+  [[nodiscard]] uint32_t a12RiseDot() const;
+  [[nodiscard]] uint32_t scanlineIrqDot() const;
+  void clockScanlineCounter();
+  [[nodiscard]] uint16_t colorIndex(uint8 paletteIndex);
+  const std::array<uint8_t, 8> &decodedTileRow(uint16 address, bool flipped);
+  [[nodiscard]] bool isSprite0HitPossible() const;
+  void renderScanline();
+  void drawScanline();
+  void clearSecondaryOam();
+  void evaluateSprites();
+  void incrementCoarseX();
+  void incrementFineY();
+  void copyHorizontalPosition();
+  void copyVerticalPosition();
 };
 
 } // namespace nesturbia
@@ -0,0 +1,54 @@
+#ifndef NESTURBIA_REWIND_HPP_INCLUDED
+#define NESTURBIA_REWIND_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nesturbia {
+
+// A history of states (see Nesturbia::SaveState()) in a fixed amount of memory
+// Only the newest state is kept as is; every older state is stored as the XOR of it and the state
+// after it, with the runs of zeros compressed away
+// Most of the state barely changes from one frame to the next, so these deltas are small
+// When the buffer is full, the oldest states are dropped to make room
+struct RewindBuffer {
+  // Data
+  size_t stateSize = 0;
+
+  // A copy of the newest state
+  std::vector<uint8_t> latestState;
+  bool hasLatestState = false;
+
+  // Ring buffer of compressed deltas, from oldest (tail) to newest (head)
+  // Each one is stored as [size][delta][size], so it can be found from both ends
+  std::vector<uint8_t> deltas;
+  size_t head = 0;
+  size_t tail = 0;
+  size_t usedSize = 0;
+  size_t numDeltas = 0;
+
+  // The delta that's being encoded or decoded
+  std::vector<uint8_t> scratch;
+
+  // Public functions
+  // Allocates all of the memory up front; nothing is allocated when pushing or popping states
+  void Reset(size_t bufferSize, size_t stateSize);
+
+  // The number of states that can be popped
+  [[nodiscard]] size_t NumStates() const;
+
+  void Push(const uint8_t *state);
+
+  // Drops the newest state, and copies the state before it to `state`
+  bool Pop(uint8_t *state);
+
+  // Private functions
+  void readDeltas(size_t offset, void *data, size_t dataSize) const;
+  void writeDeltas(size_t offset, const void *data, size_t dataSize);
+  void dropOldestDelta();
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_REWIND_HPP_INCLUDED
@@ -0,0 +1,81 @@
+#ifndef NESTURBIA_SERIALIZER_HPP_INCLUDED
+#define NESTURBIA_SERIALIZER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace nesturbia {
+
+// Copies the emulator's state to or from a flat buffer (see Nesturbia::SaveState())
+// Every component passes its fields to the serializer in a fixed order, and the same function is
+// used for measuring, saving and loading, so that those can't get out of sync
+// Fields are copied as raw bytes: states can only be loaded by the same build on the same platform
+struct Serializer {
+  // Types
+  enum class mode_t { measure, save, load };
+
+  // Data
+  mode_t mode = mode_t::measure;
+  uint8_t *output = nullptr;
+  const uint8_t *input = nullptr;
+  size_t size = 0;
+
+  // The number of bytes that were measured/saved/loaded so far
+  size_t offset = 0;
+
+  // Cleared if the buffer is too small, or if the state doesn't match this emulator
+  bool isValid = true;
+
+  // Public functions
+  static Serializer Measure() { return {}; }
+
+  static Serializer Save(void *data, size_t dataSize) {
+    Serializer serializer;
+    serializer.mode = mode_t::save;
+    serializer.output = static_cast<uint8_t *>(data);
+    serializer.size = dataSize;
+    return serializer;
+  }
+
+  static Serializer Load(const void *data, size_t dataSize) {
+    Serializer serializer;
+    serializer.mode = mode_t::load;
+    serializer.input = static_cast<const uint8_t *>(data);
+    serializer.size = dataSize;
+    return serializer;
+  }
+
+  [[nodiscard]] bool IsLoading() const { return mode == mode_t::load; }
+
+  template <typename T> void operator()(T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "Only plain data can be serialized");
+    Bytes(&value, sizeof(value));
+  }
+
+  void Bytes(void *data, size_t dataSize) {
+    if (!isValid) {
+      return;
+    }
+
+    if (mode != mode_t::measure) {
+      if (dataSize > size - offset) {
+        isValid = false;
+        return;
+      }
+
+      if (mode == mode_t::save) {
+        std::memcpy(output + offset, data, dataSize);
+      } else {
+        std::memcpy(data, input + offset, dataSize);
+      }
+    }
+
+    offset += dataSize;
+  }
+};
+
+} // namespace nesturbia
+
+#endif // NESTURBIA_SERIALIZER_HPP_INCLUDED
@@ -1,11 +1,16 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
 #include <unordered_map>
 #include <vector>
@@ -37,43 +42,214 @@ constexpr auto kFragmentShader = "#version 330 core\n"
                                  "uniform sampler2D tex;\n"
                                  "void main() { FragColor = texture(tex, TexCoord); }";
 
+// Audio (the defaults can be changed on the command line)
+constexpr uint32_t kDefaultSampleRate = 44100;
+constexpr unsigned long kDefaultFramesPerBuffer = 64;
+
+// How much audio is kept queued up for the device on average, which is its added latency
+constexpr double kDefaultTargetAudioLatency = 0.020;
+
+// The most that the sample rate is changed by to keep the queue at its target (a pitch change of
+// 0.5% isn't audible)
+constexpr double kMaxSampleRateAdjustment = 0.005;
+
+// Frames are uploaded through a ring of pixel buffers, so that the driver copies one frame to the
+// texture while the next one is being emulated
+constexpr size_t kNumPixelBuffers = 3;
+constexpr GLsizeiptr kFrameSize =
+    nesturbia::Ppu::kScreenWidth * nesturbia::Ppu::kScreenHeight * sizeof(uint32_t);
+
+// GL_ARB_buffer_storage (core in OpenGL 4.4) is newer than the OpenGL 3.3 that glad loads, so
+// glBufferStorage() and its flags are loaded by hand
+constexpr GLbitfield kMapPersistentBit = 0x0040;
+constexpr GLbitfield kMapCoherentBit = 0x0080;
+using gl_buffer_storage_t = void(APIENTRYP)(GLenum target, GLsizeiptr size, const void *data,
+                                            GLbitfield flags);
+
 // Local types
 // This allows the std::unique_ptr<GLFWwindow> to properly free the window upon destruction
 struct glfwDeleter {
   void operator()(GLFWwindow *window) { glfwDestroyWindow(window); }
 };
 
+// Hands the latest frame from the emulation thread to the render thread without locking
+// The writer and the reader each own one of the three frames, and swap theirs with the one in the
+// middle, so neither of them ever waits for the other (frames that aren't read in time are dropped)
+struct triple_buffer_t {
+  // Constants
+  static inline constexpr uint8_t kIndexMask = 0x03;
+
+  // Set in `middle` while it holds a frame that the reader hasn't taken yet
+  static inline constexpr uint8_t kIsNewBit = 0x04;
+
+  // Types
+  using frame_t =
+      std::array<uint16_t, nesturbia::Ppu::kScreenWidth * nesturbia::Ppu::kScreenHeight>;
+
+  // Data
+  std::array<frame_t, 3> frames;
+  uint8_t writeIndex = 0;
+  std::atomic<uint8_t> middle = 1;
+  uint8_t readIndex = 2;
+
+  // Public functions
+  // The frame that the writer fills in
+  frame_t &WriteFrame() { return frames[writeIndex]; }
+
+  // Makes the write frame the latest one, and takes the one that it replaces to write next
+  void Publish() {
+    writeIndex = middle.exchange(writeIndex | kIsNewBit, std::memory_order_acq_rel) & kIndexMask;
+  }
+
+  // Takes the latest frame if the writer published one since the last call
+  bool Update() {
+    if ((middle.load(std::memory_order_relaxed) & kIsNewBit) == 0) {
+      return false;
+    }
+
+    readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  // The frame that the reader took last
+  [[nodiscard]] const frame_t &ReadFrame() const { return frames[readIndex]; }
+};
+
+// Audio settings, which can be changed from the command line
+struct audio_options_t {
+  uint32_t sampleRate = kDefaultSampleRate;
+
+  // The number of samples that PortAudio asks for at once
+  unsigned long framesPerBuffer = kDefaultFramesPerBuffer;
+
+  double targetLatency = kDefaultTargetAudioLatency;
+
+  // Print the queue's statistics once per second
+  bool printStats = false;
+};
+
+// Passes samples from the emulation thread (the only writer) to the audio callback (the only
+// reader) without locking
+// The positions only ever increase (their difference is the number of queued samples), and each one
+// is on its own cache line, so that the threads don't keep taking the line away from each other
+struct audio_ring_t {
+  // Constants
+  static inline constexpr size_t kCapacity = 16384;
+  static inline constexpr size_t kCacheLineSize = 64;
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "The capacity must be a power of 2");
+
+  // Data
+  std::array<float, kCapacity> samples;
+
+  // The statistics are next to the position of the thread that updates them
+  alignas(kCacheLineSize) std::atomic<size_t> readPosition = 0;
+
+  // Pops that ran out of samples
+  std::atomic<uint32_t> numUnderruns = 0;
+
+  alignas(kCacheLineSize) std::atomic<size_t> writePosition = 0;
+
+  // Pushes that didn't fit (and were partly or fully dropped)
+  std::atomic<uint32_t> numOverruns = 0;
+
+  // Public functions
+  // Only called by the writer; returns how many samples fit (the rest are dropped)
+  size_t Push(const float *input, size_t numSamples) {
+    const auto write = writePosition.load(std::memory_order_relaxed);
+    const auto read = readPosition.load(std::memory_order_acquire);
+    const auto numPushed = std::min(numSamples, kCapacity - (write - read));
+
+    for (size_t i = 0; i < numPushed; i++) {
+      samples[(write + i) & (kCapacity - 1)] = input[i];
+    }
+
+    writePosition.store(write + numPushed, std::memory_order_release);
+    if (numPushed != numSamples) {
+      numOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return numPushed;
+  }
+
+  // Only called by the reader; returns how many samples were queued (up to `numSamples`)
+  size_t Pop(float *output, size_t numSamples) {
+    const auto read = readPosition.load(std::memory_order_relaxed);
+    const auto write = writePosition.load(std::memory_order_acquire);
+    const auto numPopped = std::min(numSamples, write - read);
+
+    for (size_t i = 0; i < numPopped; i++) {
+      output[i] = samples[(read + i) & (kCapacity - 1)];
+    }
+
+    readPosition.store(read + numPopped, std::memory_order_release);
+    if (numPopped != numSamples) {
+      numUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return numPopped;
+  }
+
+  [[nodiscard]] size_t Size() const {
+    const auto read = readPosition.load(std::memory_order_acquire);
+    return writePosition.load(std::memory_order_acquire) - read;
+  }
+};
+
+struct pixel_buffer_t {
+  GLuint buffer = 0;
+
+  // Where the buffer is persistently mapped (nullptr if it's mapped for every frame instead)
+  uint32_t *mapping = nullptr;
+
+  // Signaled once the GPU is done copying the buffer to the texture
+  GLsync fence = nullptr;
+};
+
 // Local variables
 std::unique_ptr<GLFWwindow, glfwDeleter> glfwWindow;
 nesturbia::Nesturbia emulator;
 nesturbia::Joypad::input_t joypadInput1;
+nesturbia::Palette palette;
 GLuint shader = -1;
 GLuint texture = -1;
 GLuint VAO = -1;
 GLuint VBO = -1;
 GLuint EBO = -1;
 std::string romSaveFilePath;
+audio_options_t audioOptions;
+std::array<pixel_buffer_t, kNumPixelBuffers> pixelBuffers;
+size_t pixelBufferIndex = 0;
+
+// Shared between the render thread (this one) and the emulation thread
+triple_buffer_t frameBuffer;
+std::atomic<nesturbia::Joypad::input_t> sharedJoypadInput1;
+std::atomic<bool> isEmulationRunning = true;
 
-struct audio_user_data_t {
-  std::array<float, 65536> samples;
-  volatile uint16_t head = 0;
-  volatile uint16_t tail = 0;
-} audio;
+audio_ring_t audioRing;
+
+// The emulator writes samples here, and hands them over in blocks
+std::array<float, 1024> audioBlock;
 
 // Local functions
 bool parseArguments(int argc, char **argv);
 bool initializeGraphics();
 bool initializeAudio();
 void runLoop();
-void audioSampleCallback(float sample);
+void runEmulation();
+void uploadFrame(const uint16_t *indexedPixels);
+void audioBlockCallback(void *userData, const float *samples, const int16_t *, size_t numSamples);
+void updateAudioSampleRate(double numQueuedSamples);
+void printAudioStats(size_t minQueuedSamples);
 void updateJoypadInput();
 void glfwErrorCallback(int error, const char *description);
 void glfwWindowSizeCallback(GLFWwindow *window, int, int);
+void printUsage();
 
 } // namespace
 
 int main(int argc, char **argv) {
   if (!parseArguments(argc, argv)) {
+    printUsage();
     return 1;
   }
 
@@ -92,12 +268,60 @@ int main(int argc, char **argv) {
 
 namespace {
 bool parseArguments(int argc, char **argv) {
-  if (argc != 2) {
-    std::cerr << "Expected one argument (ROM path)." << std::endl;
+  std::string romPathArgument;
+  for (int i = 1; i < argc; i++) {
+    const auto argument = std::string(argv[i]);
+    const auto hasValue = i + 1 < argc;
+
+    if (argument == "--sample-rate" && hasValue) {
+      const auto sampleRate = std::strtoul(argv[++i], nullptr, 10);
+      if (sampleRate < 8000 || sampleRate > 192000) {
+        std::cerr << "Expected a sample rate from 8000 to 192000 Hz." << std::endl;
+        return false;
+      }
+
+      audioOptions.sampleRate = static_cast<uint32_t>(sampleRate);
+    } else if (argument == "--audio-buffer" && hasValue) {
+      const auto framesPerBuffer = std::strtoul(argv[++i], nullptr, 10);
+      if (framesPerBuffer == 0) {
+        std::cerr << "Expected a positive number of samples per audio buffer." << std::endl;
+        return false;
+      }
+
+      audioOptions.framesPerBuffer = framesPerBuffer;
+    } else if (argument == "--audio-latency" && hasValue) {
+      const auto milliseconds = std::strtoul(argv[++i], nullptr, 10);
+      if (milliseconds == 0) {
+        std::cerr << "Expected a positive audio latency (in milliseconds)." << std::endl;
+        return false;
+      }
+
+      audioOptions.targetLatency = milliseconds / 1000.0;
+    } else if (argument == "--audio-stats") {
+      audioOptions.printStats = true;
+    } else if (romPathArgument.empty() && argument.rfind("--", 0) != 0) {
+      romPathArgument = argument;
+    } else {
+      std::cerr << "Unexpected argument '" << argument << "'." << std::endl;
+      return false;
+    }
+  }
+
+  if (romPathArgument.empty()) {
+    std::cerr << "Expected a ROM path." << std::endl;
     return false;
   }
 
-  auto romPath = std::filesystem::path(argv[1]);
+  // The queue holds up to twice its target (the level swings by a frame's worth of samples, and
+  // rate control needs room above the target)
+  const auto targetSamples = audioOptions.targetLatency * audioOptions.sampleRate;
+  if (2 * (targetSamples + audioOptions.sampleRate / 60.0) > audio_ring_t::kCapacity) {
+    std::cerr << "The audio latency is too long for the audio queue at this sample rate."
+              << std::endl;
+    return false;
+  }
+
+  auto romPath = std::filesystem::path(romPathArgument);
   if (std::filesystem::is_directory(romPath)) {
     std::cerr << "ROM path '" << romPath.string() << "' is a directory." << std::endl;
     return false;
@@ -122,6 +346,15 @@ bool parseArguments(int argc, char **argv) {
   // Close the ROM after reading
   romFile.close();
 
+  // The scanline renderer produces the same output as the dot renderer, just faster
+  emulator.ppu.renderer = nesturbia::Ppu::renderer_t::scanline;
+
+  // The colors are looked up once per frame when uploading it, instead of once per pixel
+  emulator.ppu.pixelFormat = nesturbia::Ppu::pixel_format_t::indexed;
+
+  // Band-limited synthesis aliases less than averaging, and is cheaper
+  emulator.cpu.apu.synthesis = nesturbia::Apu::synthesis_t::blep;
+
   // See if a save file exists
   romSaveFilePath = romPath.replace_extension("sav").string();
   if (auto romSaveFile = std::ifstream(romSaveFilePath, std::ios::binary)) {
@@ -157,6 +390,9 @@ bool parseArguments(int argc, char **argv) {
   case nesturbia::Mapper::mirror_t::vertical:
     std::cout << "vertical";
     break;
+  case nesturbia::Mapper::mirror_t::fourScreen:
+    std::cout << "four-screen";
+    break;
   default:
     // TODO: other mirroring types
     std::cout << "???";
@@ -288,8 +524,30 @@ bool initializeGraphics() {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 256, 240, 0, GL_RGB, GL_UNSIGNED_BYTE,
-               emulator.ppu.pixels.data());
+  // BGRA is the layout that drivers can upload without swizzling
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 240, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+
+  // Keep the pixel buffers mapped if possible, so that frames are converted straight into them
+  auto glBufferStorage = glfwExtensionSupported("GL_ARB_buffer_storage")
+                             ? reinterpret_cast<gl_buffer_storage_t>(
+                                   glfwGetProcAddress("glBufferStorage"))
+                             : nullptr;
+
+  for (auto &pixelBuffer : pixelBuffers) {
+    glGenBuffers(1, &pixelBuffer.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+
+    if (glBufferStorage) {
+      constexpr auto kFlags = GL_MAP_WRITE_BIT | kMapPersistentBit | kMapCoherentBit;
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, kFrameSize, nullptr, kFlags);
+      pixelBuffer.mapping = static_cast<uint32_t *>(
+          glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kFrameSize, kFlags));
+    } else {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, kFrameSize, nullptr, GL_STREAM_DRAW);
+    }
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
   // Success
   return true;
@@ -301,22 +559,35 @@ bool initializeAudio() {
                           void *userData) -> int {
     // Audio output buffer
     auto outElement = reinterpret_cast<float *>(outputBuffer);
+    auto &ring = *reinterpret_cast<audio_ring_t *>(userData);
 
     static float sample = 0.f;
 
-    for (unsigned long i = 0; i < framesPerBuffer; i++) {
-      if (auto audioData = reinterpret_cast<audio_user_data_t *>(userData)) {
-        if (audioData->head != audioData->tail) {
-          sample = audioData->samples[audioData->head++];
-        }
-      }
-
-      outElement[i] = sample;
+    // If the queue ran dry, hold the last sample (which is quieter than dropping to 0)
+    const auto numPopped = ring.Pop(outElement, framesPerBuffer);
+    if (numPopped != 0) {
+      sample = outElement[numPopped - 1];
     }
 
+    std::fill(outElement + numPopped, outElement + framesPerBuffer, sample);
+
     return paContinue;
   };
 
+  // The emulator hands its samples over to the callback in blocks (which go into the ring buffer)
+  nesturbia::AudioOutput audioOutput;
+  audioOutput.samples = audioBlock.data();
+  audioOutput.bufferSize = audioBlock.size();
+  audioOutput.callback = audioBlockCallback;
+  audioOutput.userData = &audioRing;
+
+  emulator.SetAudioOutput(audioOutput, audioOptions.sampleRate);
+
+  // Start with the queue at its target, so that the device doesn't run dry while it fills up
+  const std::vector<float> silence(
+      static_cast<size_t>(audioOptions.targetLatency * audioOptions.sampleRate));
+  audioRing.Push(silence.data(), silence.size());
+
   // TODO make cross-platform or see if there is a better method
   auto stderrOrig = dup(STDERR_FILENO);
   auto devnull = open("/dev/null", O_RDWR);
@@ -331,8 +602,8 @@ bool initializeAudio() {
   dup2(stderrOrig, STDERR_FILENO);
 
   PaStream *stream;
-  if (Pa_OpenDefaultStream(&stream, 0, 1, paFloat32, 44100.0, 64, audioCallback, &audio) !=
-      paNoError) {
+  if (Pa_OpenDefaultStream(&stream, 0, 1, paFloat32, audioOptions.sampleRate,
+                           audioOptions.framesPerBuffer, audioCallback, &audioRing) != paNoError) {
     goto error;
   }
 
@@ -340,9 +611,6 @@ bool initializeAudio() {
     goto error;
   }
 
-  // TODO create a constant for sample rate
-  emulator.SetAudioSampleCallback(audioSampleCallback, 44100);
-
   return true;
 
 error:
@@ -351,53 +619,44 @@ error:
 }
 
 void runLoop() {
-  // Used to determine the duration since the previous game logic update
-  double lastUpdateTime = 0.0;
-
-  // Used to determine the duration since the previous render
-  // Set to a negative value to guarantee that rendering occurs in the first iteration
-  double lastFrameTime = -1.0;
-
   glUseProgram(shader);
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, texture);
   glBindVertexArray(VAO);
 
-  // Fixed time step rendering logic
-  // Run the update logic as fast as possible
-  // If enough time has elapsed to actually render, then do so
+  // The emulation keeps its own pace on another thread, so waiting for vsync when swapping buffers
+  // (or anything else here) doesn't slow it down
+  std::thread emulationThread(runEmulation);
+
   while (!glfwWindowShouldClose(glfwWindow.get())) {
-    const auto currentTime = glfwGetTime();
-    // See if we can render in this loop
-    if ((currentTime - lastFrameTime) >= kFrameTime) {
-      // It's time to render
-      // Prepare the window for rendering (clear color buffer)
-      glClear(GL_COLOR_BUFFER_BIT);
+    // Sleep until there's input, or the emulation thread has finished a frame
+    glfwWaitEvents();
 
-      // TODO: Temporary, close the window if the ESC key is pressed
-      if (glfwGetKey(glfwWindow.get(), GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(glfwWindow.get(), true);
-      }
+    // TODO: Temporary, close the window if the ESC key is pressed
+    if (glfwGetKey(glfwWindow.get(), GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+      glfwSetWindowShouldClose(glfwWindow.get(), true);
+    }
 
-      // Get user inputs (controller/joypad)
-      // TODO: only one controller is supported for now
-      updateJoypadInput();
+    // Get user inputs (controller/joypad)
+    // TODO: only one controller is supported for now
+    updateJoypadInput();
+    sharedJoypadInput1.store(joypadInput1, std::memory_order_relaxed);
 
-      // Run one frame
-      emulator.RunFrame(joypadInput1);
+    // Only draw when there's a new frame (if several were finished, only the latest one is shown)
+    if (frameBuffer.Update()) {
+      glClear(GL_COLOR_BUFFER_BIT);
 
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 240, GL_RGB, GL_UNSIGNED_BYTE,
-                      emulator.ppu.pixels.data());
+      uploadFrame(frameBuffer.ReadFrame().data());
       glDrawArrays(GL_TRIANGLES, 0, 6);
 
       // Finish up window rendering (swap buffers)
       glfwSwapBuffers(glfwWindow.get());
-
-      // TODO input polling
-      glfwPollEvents();
     }
   }
 
+  isEmulationRunning = false;
+  emulationThread.join();
+
   // If this ROM is battery-backed (i.e., has saved info that can be loaded next time), then save
   // the output now
   if (emulator.cartridge.isBatteryBacked && !romSaveFilePath.empty()) {
@@ -409,10 +668,109 @@ void runLoop() {
   }
 }
 
-void audioSampleCallback(float sample) {
-  if (audio.tail != ((audio.head - 1) % audio.samples.size())) {
-    audio.samples[audio.tail++] = sample;
+void runEmulation() {
+  using clock = std::chrono::steady_clock;
+  const auto frameDuration =
+      std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(kFrameTime));
+
+  // The lowest queue level since the statistics were last printed
+  auto minQueuedSamples = std::numeric_limits<size_t>::max();
+  uint32_t frame = 0;
+
+  auto nextFrameTime = clock::now();
+  while (isEmulationRunning) {
+    const auto numQueuedSamples = audioRing.Size();
+    emulator.RunFrame(sharedJoypadInput1.load(std::memory_order_relaxed));
+    updateAudioSampleRate((numQueuedSamples + audioRing.Size()) / 2.0);
+
+    minQueuedSamples = std::min(minQueuedSamples, numQueuedSamples);
+    if (audioOptions.printStats && ++frame % 60 == 0) {
+      printAudioStats(minQueuedSamples);
+      minQueuedSamples = std::numeric_limits<size_t>::max();
+    }
+
+    const auto &pixels = emulator.ppu.indexedPixels;
+    std::copy(pixels.begin(), pixels.end(), frameBuffer.WriteFrame().begin());
+    frameBuffer.Publish();
+
+    // Wake up the render thread
+    glfwPostEmptyEvent();
+
+    // Sleep until the next frame is due
+    // After falling behind (e.g., when the process wasn't scheduled for a while), continue from
+    // now instead of running frames back to back to catch up
+    nextFrameTime += frameDuration;
+    const auto now = clock::now();
+    if (nextFrameTime < now - frameDuration) {
+      nextFrameTime = now;
+    }
+
+    std::this_thread::sleep_until(nextFrameTime);
+  }
+}
+
+void uploadFrame(const uint16_t *indexedPixels) {
+  auto &pixelBuffer = pixelBuffers[pixelBufferIndex];
+  pixelBufferIndex = (pixelBufferIndex + 1) % pixelBuffers.size();
+
+  // This buffer was last used kNumPixelBuffers frames ago, so the copy is normally long done
+  if (pixelBuffer.fence) {
+    glClientWaitSync(pixelBuffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(pixelBuffer.fence);
+    pixelBuffer.fence = nullptr;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+
+  // The fence already synchronized the buffer, so the driver doesn't have to
+  auto *pixels = pixelBuffer.mapping;
+  if (!pixels) {
+    constexpr auto kFlags =
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    pixels = static_cast<uint32_t *>(
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kFrameSize, kFlags));
+  }
+
+  if (pixels) {
+    palette.ConvertFrame(indexedPixels, 256, 240, nesturbia::Palette::format_t::bgra, 1, pixels);
+
+    if (!pixelBuffer.mapping) {
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // Copies from the bound pixel buffer (offset 0), and returns without waiting for it
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 240, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
   }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void audioBlockCallback(void *userData, const float *samples, const int16_t *, size_t numSamples) {
+  reinterpret_cast<audio_ring_t *>(userData)->Push(samples, numSamples);
+}
+
+void updateAudioSampleRate(double numQueuedSamples) {
+  // Dynamic rate control: the emulator and the audio device run on different clocks, so produce
+  // slightly fewer samples while the queue is above its target, and slightly more while it's below
+  // The queue settles around its target instead of slowly running dry or filling up
+  const double sampleRate = audioOptions.sampleRate;
+  const auto targetSamples = audioOptions.targetLatency * sampleRate;
+  const auto deviation = std::clamp((targetSamples - numQueuedSamples) / targetSamples, -1.0, 1.0);
+
+  emulator.SetAudioSampleRate(sampleRate * (1.0 + deviation * kMaxSampleRateAdjustment));
+}
+
+void printAudioStats(size_t minQueuedSamples) {
+  const auto toMilliseconds = [](size_t numSamples) {
+    return numSamples * 1000 / audioOptions.sampleRate;
+  };
+
+  const auto numQueuedSamples = audioRing.Size();
+  std::cout << "Audio queue: " << numQueuedSamples << " samples ("
+            << toMilliseconds(numQueuedSamples) << " ms), lowest " << minQueuedSamples << " ("
+            << toMilliseconds(minQueuedSamples) << " ms), " << audioRing.numUnderruns
+            << " underruns, " << audioRing.numOverruns << " overruns" << std::endl;
 }
 
 void updateJoypadInput() {
@@ -450,4 +808,9 @@ void glfwWindowSizeCallback(GLFWwindow *window, int, int) {
   glViewport(0, 0, frameBufferWidth, frameBufferHeight);
 }
 
+void printUsage() {
+  std::cerr << "Usage: nesturbia [--sample-rate HZ] [--audio-buffer SAMPLES]"
+            << " [--audio-latency MS] [--audio-stats] ROM" << std::endl;
+}
+
 } // namespace
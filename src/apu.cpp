@@ -0,0 +1,751 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "nesturbia/apu.hpp"
+
+namespace nesturbia {
+
+namespace {
+
+constexpr std::array<uint8_t, 32> kLengthCounterLookupTable = {
+    10, 254, 20, 2,  40, 4,  80, 6,  160, 8,  60, 10, 14, 12, 26, 14,
+    12, 16,  24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30};
+
+// The APU's nonlinear mixer, as lookup tables (see NESDEV)
+// The pulse channels are mixed together, and so are the triangle, noise and DMC channels (TND)
+constexpr std::array<float, 31> createPulseTable() {
+  std::array<float, 31> table = {};
+  for (size_t i = 1; i < table.size(); i++) {
+    table[i] = static_cast<float>(95.52 / (8128.0 / i + 100));
+  }
+
+  return table;
+}
+
+// Indexed by 3 * triangle + 2 * noise + DMC
+constexpr std::array<float, 203> createTndTable() {
+  std::array<float, 203> table = {};
+  for (size_t i = 1; i < table.size(); i++) {
+    table[i] = static_cast<float>(163.67 / (24329.0 / i + 100));
+  }
+
+  return table;
+}
+
+constexpr auto kPulseTable = createPulseTable();
+constexpr auto kTndTable = createTndTable();
+
+// Band-limited steps are spread over kBlepWidth samples, and the position of a step between two
+// samples is quantized to kBlepPhases
+constexpr size_t kBlepWidth = 16;
+constexpr size_t kBlepPhases = 32;
+
+static_assert(kBlepWidth <= std::tuple_size_v<decltype(Apu::blepBuffer)>);
+
+using blep_kernel_t = std::array<std::array<double, kBlepWidth>, kBlepPhases>;
+
+blep_kernel_t createBlepKernel() {
+  constexpr auto kPi = 3.14159265358979323846;
+
+  // Cutoff frequency, relative to the sample rate
+  constexpr auto kCutoff = 0.45;
+
+  // Blackman-windowed sinc, centered on 0 (the steps are delayed by half the kernel's width)
+  const auto impulse = [](double x) {
+    constexpr auto kHalfWidth = kBlepWidth / 2.0;
+    if (std::abs(x) >= kHalfWidth) {
+      return 0.0;
+    }
+
+    const auto sinc = x == 0.0 ? 1.0 : std::sin(2 * kPi * kCutoff * x) / (2 * kPi * kCutoff * x);
+    const auto window = 0.42 + 0.5 * std::cos(kPi * x / kHalfWidth) +
+                        0.08 * std::cos(2 * kPi * x / kHalfWidth);
+
+    return 2 * kCutoff * sinc * window;
+  };
+
+  blep_kernel_t kernel;
+  for (size_t phase = 0; phase < kBlepPhases; phase++) {
+    const auto offset = (phase + 0.5) / kBlepPhases + kBlepWidth / 2.0;
+
+    // Each entry is the part of the step that lands in that sample: the impulse integrated over
+    // the sample's length
+    constexpr size_t kSteps = 32;
+
+    double sum = 0;
+    for (size_t i = 0; i < kBlepWidth; i++) {
+      double value = 0;
+      for (size_t step = 0; step < kSteps; step++) {
+        value += impulse(i - offset + (step + 0.5) / kSteps) / kSteps;
+      }
+
+      kernel[phase][i] = value;
+      sum += value;
+    }
+
+    // Make sure that the whole step is added, so that the output doesn't drift
+    kernel[phase][kBlepWidth / 2] += 1.0 - sum;
+  }
+
+  return kernel;
+}
+
+const auto kBlepKernel = createBlepKernel();
+
+} // namespace
+
+void Apu::Power() {
+  frameCounter.resetShiftRegisterTicks = 0;
+  frameCounter.shiftRegister = 0x7fff;
+  frameCounter.interruptInhibit = false;
+  frameCounter.mode = false;
+  frameCounter.interruptFlag = 0;
+
+  // TODO: should the APU run while the CPU resets?
+  // This is technically 'even' if 7 cycles ran during a reset
+  isOddCycle = false;
+}
+
+bool Apu::Tick() {
+  bool isIrq = false;
+
+  if (isOddCycle) {
+    if (frameCounter.resetShiftRegisterTicks != 0 &&
+        (--frameCounter.resetShiftRegisterTicks == 0)) {
+      frameCounter.shiftRegister = 0x7fff;
+    } else {
+      // 14-bit linear feedback shift register
+      // The top two bits are XORed and put into bit 0
+      // The rest of the bits are shifted by one
+      frameCounter.shiftRegister =
+          ((frameCounter.shiftRegister << 1) & 0x7ffe) |
+          (frameCounter.shiftRegister.bit(14) ^ frameCounter.shiftRegister.bit(13));
+    }
+
+    const auto isStep1 = frameCounter.shiftRegister == 0x1061;
+    const auto isStep2 = frameCounter.shiftRegister == 0x3603;
+    const auto isStep3 = frameCounter.shiftRegister == 0x2cd3;
+    const auto isStep4 = (!frameCounter.mode && frameCounter.shiftRegister == 0x0a1f) ||
+                         frameCounter.shiftRegister == 0x7185;
+
+    // Quarter frames occur every step
+    if (isStep1 || isStep2 || isStep3 || isStep4) {
+      quarterFrame();
+    }
+
+    // Half frames occur on step 2 and 4
+    if (isStep2 || isStep4) {
+      halfFrame();
+    }
+
+    // Set the IRQ on step 4 (mode 0 only)
+    // TODO the IRQ is set continuously in this condition, not just in this tick
+    if (isStep4 && !frameCounter.mode && !frameCounter.interruptInhibit) {
+      isIrq = true;
+      frameCounter.interruptFlag = 1;
+    } else if (frameCounter.interruptFlag) {
+      frameCounter.interruptFlag = 2;
+    }
+
+    // Flag that the shift register should reset from step 4
+    if (isStep4) {
+      frameCounter.resetShiftRegisterTicks = 2;
+    }
+
+    // TODO should this be on even cycles?
+    // Pulse channel code that's executed every APU cycle
+    for (auto &pulse : pulseChannels) {
+      if (pulse.timerCounter == 0) {
+        pulse.timerCounter = pulse.period;
+
+        // 3-bit value that wraps around
+        pulse.dutyIndex = (pulse.dutyIndex - 1) & 0x7;
+      } else {
+        --pulse.timerCounter;
+      }
+    }
+
+    // Noise channel timer
+    if (noiseChannel.timerCounter == 0) {
+      noiseChannel.timerCounter = noiseChannel.period;
+
+      const auto bit0 = noiseChannel.shiftRegister.bit(0);
+      const auto bit1 = noiseChannel.shiftRegister.bit(noiseChannel.mode ? 6 : 1);
+
+      noiseChannel.shiftRegister >>= 1;
+      noiseChannel.shiftRegister |= (bit0 ^ bit1) << 14;
+    } else {
+      --noiseChannel.timerCounter;
+    }
+
+    // DMC channel timer
+    if (dmcChannel.enabled) {
+      if (dmcChannel.length != 0 && dmcChannel.bitCount == 0) {
+        // TODO: CPU stall?
+        // BQS TODO add a 'peek' to prevent infinite recursion
+        dmcChannel.shiftRegister = dmcRead(dmcReadContext, dmcChannel.address++);
+        dmcChannel.bitCount = 8;
+
+        if (dmcChannel.address == 0) {
+          dmcChannel.address = 0x8000;
+        }
+
+        --dmcChannel.length;
+        if (dmcChannel.length == 0 && dmcChannel.loop) {
+          dmcChannel.address = dmcChannel.sampleAddress;
+          dmcChannel.length = dmcChannel.sampleLength;
+        }
+      }
+
+      if (dmcChannel.tickValue == 0) {
+        dmcChannel.tickValue = dmcChannel.period;
+
+        if (dmcChannel.bitCount != 0) {
+          if (dmcChannel.shiftRegister.bit(0)) {
+            if (dmcChannel.value <= 125) {
+              dmcChannel.value += 2;
+            }
+          } else {
+            if (dmcChannel.value >= 2) {
+              dmcChannel.value -= 2;
+            }
+          }
+
+          dmcChannel.shiftRegister >>= 1;
+          --dmcChannel.bitCount;
+        }
+      } else {
+        --dmcChannel.tickValue;
+      }
+    }
+  }
+
+  // Triangle channel code that's executed every CPU cycle
+  // (most APU channel code executes on an APU cycle, which is 2 CPU cycles)
+  if (triangleChannel.timerCounter == 0) {
+    triangleChannel.timerCounter = triangleChannel.period;
+
+    if (triangleChannel.length.value != 0 && triangleChannel.linearCounter.value != 0) {
+      // 5-bit value that wraps around
+      triangleChannel.dutyIndex = (triangleChannel.dutyIndex + 1) & 0x1f;
+    }
+  } else {
+    --triangleChannel.timerCounter;
+  }
+
+  isOddCycle = !isOddCycle;
+
+  if (!isOutputEnabled) {
+    return isIrq;
+  }
+
+  const auto output = channelOutput();
+  if (output != lastOutput) {
+    lastOutput = output;
+
+    const auto level = mix(output);
+    if (synthesis == synthesis_t::blep && audioOutput.samples) {
+      addBlepStep(level - outputLevel);
+    }
+
+    outputLevel = level;
+  }
+
+  if (synthesis == synthesis_t::average) {
+    sampleSum += outputLevel;
+    ++numSamples;
+  }
+
+  if (++elapsedCycles > ticksPerSample) {
+    // New sample
+    elapsedCycles -= ticksPerSample;
+
+    if (audioOutput.samples) {
+      const auto level =
+          synthesis == synthesis_t::average ? sampleSum / numSamples : readBlepSample();
+      const auto sample = static_cast<float>(level / 4);
+      audioOutput.samples[numBufferedSamples] = sample;
+
+      if (audioOutput.int16Samples) {
+        audioOutput.int16Samples[numBufferedSamples] =
+            static_cast<int16_t>(std::clamp(sample, -1.0F, 1.0F) * 32767.0F);
+      }
+
+      if (++numBufferedSamples == audioOutput.bufferSize) {
+        FlushAudio();
+      }
+    }
+
+    sampleSum = 0;
+    numSamples = 0;
+  }
+
+  return isIrq;
+}
+
+uint8 Apu::ReadStatus() {
+  uint8 value = 0;
+
+  value |= (pulseChannels[0].length.value != 0) << 0;
+  value |= (pulseChannels[1].length.value != 0) << 1;
+  value |= (triangleChannel.length.value != 0) << 2;
+  value |= (noiseChannel.length.value != 0) << 3;
+
+  // TODO: is this correct?
+  value |= (dmcChannel.length != 0) << 4;
+
+  value |= (frameCounter.interruptFlag != 0) << 6;
+  if (frameCounter.interruptFlag != 1) {
+    frameCounter.interruptFlag = 0;
+  }
+
+  // TODO: bit 7
+
+  return value;
+}
+
+void Apu::WriteRegister(uint16 address, uint8 value) {
+  auto &pulseChannel = pulseChannels[static_cast<uint8>(address.bit(2))];
+
+  switch (address) {
+  case 0x4000:
+  case 0x4004:
+    pulseChannel.duty = (value.bit(7) << 1) | value.bit(6);
+    pulseChannel.length.halt = value.bit(5);
+    pulseChannel.envelope.loop = value.bit(5);
+    pulseChannel.envelope.disabled = value.bit(4);
+    pulseChannel.envelope.volume = value & 0xf;
+    return;
+
+  case 0x4001:
+  case 0x4005:
+    pulseChannel.sweep.enabled = value.bit(7);
+    pulseChannel.sweep.period = ((value >> 4) & 0x7) + 1;
+    pulseChannel.sweep.negate = value.bit(3);
+    pulseChannel.sweep.shiftAmount = value & 0x7;
+
+    // Side effect: set the reload flag
+    pulseChannel.sweep.reload = true;
+
+    // TODO double-check this
+    pulseChannel.envelope.reload = true;
+    return;
+
+  case 0x4002:
+  case 0x4006:
+    pulseChannel.period &= 0x700;
+    pulseChannel.period |= value;
+    return;
+
+  case 0x4003:
+  case 0x4007:
+    pulseChannel.period &= 0x0ff;
+    pulseChannel.period |= (value & 0x7) << 8;
+
+    // Length counter load (L) - only when channel enabled via $4015 register
+    if (pulseChannel.enabled) {
+      pulseChannel.length.value = kLengthCounterLookupTable[value >> 3];
+    }
+
+    // Side effect: Reset the 3-bit ([0-7]) index into the duty cycle table
+    pulseChannel.dutyIndex = 0;
+
+    // Side effect: Reload the pulse channel envelope next APU tick
+    pulseChannel.envelope.reload = true;
+    return;
+
+  case 0x4008:
+    triangleChannel.length.halt = value.bit(7);
+    triangleChannel.linearCounter.load = value & 0x7f;
+    return;
+
+  case 0x4009:
+    // No-op
+    return;
+
+  case 0x400a:
+    // Timer (T) low
+    triangleChannel.period &= 0x700;
+    triangleChannel.period |= value;
+    return;
+
+  case 0x400b: {
+    // Timer (T) high (top 3 bits)
+    triangleChannel.period &= 0x0ff;
+    triangleChannel.period |= (value & 0x7) << 8;
+
+    triangleChannel.timerCounter = triangleChannel.period;
+
+    // Length counter load (L)
+    if (triangleChannel.enabled) {
+      triangleChannel.length.value = kLengthCounterLookupTable[value >> 3];
+    }
+
+    // Reload the linear counter
+    triangleChannel.linearCounter.reload = true;
+
+    // Clear the duty cycle index
+    triangleChannel.dutyIndex = 0;
+  }
+    return;
+
+  case 0x400c:
+    noiseChannel.length.halt = value.bit(5);
+    noiseChannel.envelope.loop = value.bit(5);
+    noiseChannel.envelope.disabled = value.bit(4);
+    noiseChannel.envelope.volume = value & 0xf;
+    noiseChannel.envelope.count = value & 0xf;
+
+    // TODO double-check this
+    noiseChannel.envelope.reload = true;
+    return;
+
+  case 0x400d:
+    // No-op
+    return;
+
+  case 0x400e: {
+    noiseChannel.mode = value.bit(7);
+
+    // TODO move somewhere else?
+    constexpr std::array<uint16_t, 16> kNoisePeriod = {4,   8,   16,  32,  64,  96,   128,  160,
+                                                       202, 254, 380, 508, 762, 1016, 2034, 4068};
+
+    noiseChannel.period = kNoisePeriod[value & 0xf];
+    return;
+  }
+
+  case 0x400f:
+    // Length counter load (L)
+    if (noiseChannel.enabled) {
+      noiseChannel.length.value = kLengthCounterLookupTable[value >> 3];
+    }
+
+    // Side effect: Reload the noise channel envelope next APU tick
+    noiseChannel.envelope.reload = true;
+    return;
+
+  case 0x4010: {
+    dmcChannel.irqEnabled = value.bit(7);
+    dmcChannel.loop = value.bit(6);
+
+    // TODO move somewhere else?
+    constexpr std::array<uint16_t, 16> kDmcPeriod = {214, 190, 170, 160, 143, 127, 113, 107,
+                                                     95,  80,  71,  64,  53,  42,  36,  27};
+
+    dmcChannel.period = kDmcPeriod[value & 0xf];
+    return;
+  }
+
+  case 0x4011:
+    dmcChannel.value = value & 0x7f;
+    return;
+
+  case 0x4012:
+    dmcChannel.sampleAddress = 0xc000 | (value << 6);
+    return;
+
+  case 0x4013:
+    dmcChannel.sampleLength = (value << 4) | 0x1;
+    return;
+
+  case 0x4015:
+    dmcChannel.enabled = value.bit(4);
+    if (!dmcChannel.enabled) {
+      dmcChannel.length = 0;
+    } else if (dmcChannel.length == 0) {
+      dmcChannel.address = dmcChannel.sampleAddress;
+      dmcChannel.length = dmcChannel.sampleLength;
+    }
+
+    noiseChannel.enabled = value.bit(3);
+    if (!noiseChannel.enabled) {
+      noiseChannel.length.value = 0;
+    }
+
+    triangleChannel.enabled = value.bit(2);
+    if (!triangleChannel.enabled) {
+      triangleChannel.length.value = 0;
+    }
+
+    pulseChannels[1].enabled = value.bit(1);
+    if (!pulseChannels[1].enabled) {
+      pulseChannels[1].length.value = 0;
+    }
+
+    pulseChannels[0].enabled = value.bit(0);
+    if (!pulseChannels[0].enabled) {
+      pulseChannels[0].length.value = 0;
+    }
+    return;
+
+  case 0x4017:
+    frameCounter.mode = value.bit(7);
+
+    frameCounter.interruptInhibit = value.bit(6);
+    if (frameCounter.interruptInhibit) {
+      frameCounter.interruptFlag = 0;
+    }
+
+    // TODO: NESDEV says that timer is reset 3 to 4 cycles after this register is written
+    frameCounter.resetShiftRegisterTicks = 2;
+
+    // Quarter/half frame signals are generated if mode flag is set during this register write
+    if (frameCounter.mode) {
+      quarterFrame();
+      halfFrame();
+    }
+    return;
+
+  default:
+    // $4018-$401f are used for CPU test mode (normally disabled)
+    return;
+  }
+}
+
+Apu::channel_output_t Apu::channelOutput() const {
+  channel_output_t output;
+
+  // Pulse output
+  for (size_t i = 0; i < pulseChannels.size(); i++) {
+    const auto &pulse = pulseChannels[i];
+    if (!pulse.enabled || pulse.length.value == 0) {
+      continue;
+    }
+
+    // TODO move somewhere else?
+    constexpr std::array<uint8_t, 4> kPulseDuty = {0x40, 0x60, 0x78, 0x9f};
+    if (!uint8(kPulseDuty[pulse.duty]).bit(pulse.dutyIndex)) {
+      continue;
+    }
+
+    // TODO double check this
+    if (pulse.period < 8 || pulse.timerCounter > 0x7ff) {
+      continue;
+    }
+
+    output.pulse[i] = pulse.envelope.disabled ? pulse.envelope.volume : pulse.envelope.count;
+  }
+
+  // Triangle output
+  if (triangleChannel.enabled && triangleChannel.length.value != 0 &&
+      triangleChannel.linearCounter.value != 0) {
+    // TODO move somewhere else?
+    constexpr std::array<uint8_t, 32> kTriangleTable = {15, 14, 13, 12, 11, 10, 9,  8,  7,  6, 5,
+                                                        4,  3,  2,  1,  0,  0,  1,  2,  3,  4, 5,
+                                                        6,  7,  8,  9,  10, 11, 12, 13, 14, 15};
+
+    output.triangle = kTriangleTable.at(triangleChannel.dutyIndex);
+  }
+
+  // Noise output
+  if (noiseChannel.enabled && noiseChannel.length.value != 0 &&
+      !noiseChannel.shiftRegister.bit(0)) {
+    output.noise = noiseChannel.envelope.disabled ? noiseChannel.envelope.volume
+                                                  : noiseChannel.envelope.count;
+  }
+
+  // DMC output
+  output.dmc = dmcChannel.value;
+
+  return output;
+}
+
+float Apu::mix(const channel_output_t &output) {
+  return kPulseTable[output.pulse[0] + output.pulse[1]] +
+         kTndTable[3 * output.triangle + 2 * output.noise + output.dmc];
+}
+
+void Apu::addBlepStep(double delta) {
+  // Where the step lies between the previous sample and the next one
+  const auto phase = std::min(static_cast<size_t>(elapsedCycles / ticksPerSample * kBlepPhases),
+                              kBlepPhases - 1);
+
+  const auto &kernel = kBlepKernel[phase];
+  for (size_t i = 0; i < kernel.size(); i++) {
+    blepBuffer[(blepIndex + i) % blepBuffer.size()] += delta * kernel[i];
+  }
+}
+
+double Apu::readBlepSample() {
+  blepIntegrator += blepBuffer[blepIndex];
+  blepBuffer[blepIndex] = 0;
+  blepIndex = (blepIndex + 1) % blepBuffer.size();
+
+  return blepIntegrator;
+}
+
+void Apu::SetAudioOutput(const AudioOutput &audioOutput, uint32_t sampleRate) {
+  // Hand over anything that was written to the previous buffer(s)
+  FlushAudio();
+
+  this->audioOutput = audioOutput;
+  if (audioOutput.bufferSize == 0) {
+    // Nowhere to write samples to
+    this->audioOutput.samples = nullptr;
+  }
+
+  SetSampleRate(sampleRate);
+
+  // Nothing was synthesized without a buffer, so start over from the current level
+  blepBuffer = {};
+  blepIntegrator = outputLevel;
+}
+
+void Apu::FlushAudio() {
+  if (numBufferedSamples != 0 && audioOutput.callback) {
+    audioOutput.callback(audioOutput.userData, audioOutput.samples, audioOutput.int16Samples,
+                         numBufferedSamples);
+  }
+
+  numBufferedSamples = 0;
+}
+
+void Apu::SetSampleRate(double sampleRate) {
+  // TODO: document where these numbers came from
+  ticksPerSample = 89341.5 / 3.0 * 60.0 / sampleRate;
+}
+
+void Apu::Serialize(Serializer &serializer) {
+  serializer(pulseChannels);
+  serializer(triangleChannel);
+  serializer(noiseChannel);
+  serializer(dmcChannel);
+  serializer(frameCounter);
+  serializer(isOddCycle);
+
+  serializer(elapsedCycles);
+  serializer(lastOutput);
+  serializer(outputLevel);
+  serializer(sampleSum);
+  serializer(numSamples);
+  serializer(blepIntegrator);
+  serializer(blepBuffer);
+  serializer(blepIndex);
+}
+
+void Apu::quarterFrame() {
+  // Pulse: envelopes
+  for (auto &pulse : pulseChannels) {
+    if (pulse.envelope.reload) {
+      pulse.envelope.reload = false;
+      pulse.envelope.divider = pulse.envelope.volume;
+      pulse.envelope.count = 0xf;
+    } else {
+      if (pulse.envelope.divider == 0) {
+        pulse.envelope.divider = pulse.envelope.volume;
+
+        if (pulse.envelope.count != 0 || pulse.envelope.loop) {
+          pulse.envelope.count = (pulse.envelope.count - 1) & 0xf;
+        }
+      } else {
+        --pulse.envelope.divider;
+      }
+    }
+  }
+
+  // Triangle: linear counter
+  if (triangleChannel.linearCounter.reload) {
+    triangleChannel.linearCounter.value = triangleChannel.linearCounter.load;
+  } else {
+    if (triangleChannel.linearCounter.value != 0) {
+      --triangleChannel.linearCounter.value;
+    }
+  }
+
+  if (!triangleChannel.length.halt) {
+    // Disable reloading if bit 7 of $4008 is cleared
+    triangleChannel.linearCounter.reload = false;
+  }
+
+  // Noise: envelope
+  if (noiseChannel.envelope.reload) {
+    noiseChannel.envelope.reload = false;
+    noiseChannel.envelope.divider = noiseChannel.envelope.volume;
+    noiseChannel.envelope.count = 0xf;
+  } else {
+    if (noiseChannel.envelope.divider == 0) {
+      noiseChannel.envelope.divider = noiseChannel.envelope.volume;
+
+      if (noiseChannel.envelope.count != 0 || noiseChannel.envelope.loop) {
+        noiseChannel.envelope.count = (noiseChannel.envelope.count - 1) & 0xf;
+      }
+    } else {
+      --noiseChannel.envelope.divider;
+    }
+  }
+}
+
+void Apu::halfFrame() {
+  // Pulse: sweep + length counters
+  bool isPulse1 = true;
+  for (auto &pulse : pulseChannels) {
+    // Sweep
+    if (pulse.sweep.reload) {
+      // TODO this logic is duplicated below
+      if (pulse.sweep.enabled) {
+        pulse.sweep.divider = pulse.sweep.period;
+        if (pulse.sweep.enabled && pulse.sweep.shiftAmount != 0) {
+          auto periodShifted = pulse.period >> pulse.sweep.shiftAmount;
+          if (pulse.sweep.negate) {
+            // Get the one's complement (used by pulse 1)
+            periodShifted = ~periodShifted;
+            if (!isPulse1) {
+              // Pulse 2 uses the two's complement (one's complement + 1)
+              ++periodShifted;
+            }
+          }
+
+          pulse.period += periodShifted;
+        }
+      }
+
+      pulse.sweep.reload = false;
+      pulse.sweep.divider = pulse.sweep.period;
+    } else {
+      if (pulse.sweep.divider == 0) {
+        // TODO this logic is duplicated above
+        if (pulse.sweep.enabled) {
+          pulse.sweep.divider = pulse.sweep.period;
+          if (pulse.sweep.enabled && pulse.sweep.shiftAmount != 0) {
+            auto periodShifted = pulse.period >> pulse.sweep.shiftAmount;
+            if (pulse.sweep.negate) {
+              // Get the one's complement (used by pulse 1)
+              periodShifted = ~periodShifted;
+              if (!isPulse1) {
+                // Pulse 2 uses the two's complement (one's complement + 1)
+                ++periodShifted;
+              }
+            }
+
+            pulse.period += periodShifted;
+          }
+        }
+      } else {
+        --pulse.sweep.divider;
+      }
+    }
+
+    // Length counter
+    if (!pulse.length.halt && pulse.length.value != 0) {
+      --pulse.length.value;
+    }
+
+    isPulse1 = false;
+  }
+
+  // Triangle: length counter
+  if (!triangleChannel.length.halt && triangleChannel.length.value != 0) {
+    --triangleChannel.length.value;
+  }
+
+  // Noise: length counter
+  if (!noiseChannel.length.halt && noiseChannel.length.value != 0) {
+    --noiseChannel.length.value;
+  }
+
+  // TODO other waveforms?
+}
+
+} // namespace nesturbia
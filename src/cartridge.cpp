@@ -1,12 +1,19 @@
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <utility>
 #include <vector>
 
 #include "nesturbia/cartridge.hpp"
 #include "nesturbia/mapper.hpp"
 #include "nesturbia/mappers/mapper0.hpp"
 #include "nesturbia/mappers/mapper1.hpp"
+#include "nesturbia/mappers/mapper11.hpp"
+#include "nesturbia/mappers/mapper2.hpp"
 #include "nesturbia/mappers/mapper3.hpp"
 #include "nesturbia/mappers/mapper4.hpp"
+#include "nesturbia/mappers/mapper66.hpp"
+#include "nesturbia/mappers/mapper7.hpp"
 #include "nesturbia/util/crc32.hpp"
 #include "nesturbia/util/md5.hpp"
 
@@ -20,15 +27,22 @@ bool Cartridge::LoadRom(const void *romData, size_t romDataSize) {
     return false;
   }
 
-  prgRom16KUnits = rom[4];
-  chrRom8KUnits = rom[5];
-  mirrorType = rom[6].bit(0) ? Mapper::mirror_t::vertical : Mapper::mirror_t::horizontal;
-  isBatteryBacked = rom[6].bit(1);
-  hasTrainer = rom[6].bit(2);
-  mapperNumber = static_cast<uint8>((rom[6] >> 4) | (rom[7] & 0xf0));
-  isNesV2 = rom[6].bit(3) && !rom[6].bit(2);
+  // The header is only applied once the ROM is known to be valid, so that a failed load leaves the
+  // current game as it is
+  const uint8 newPrgRom16KUnits = rom[4];
+  const uint8 newChrRom8KUnits = rom[5];
+  auto newMirrorType = rom[6].bit(0) ? Mapper::mirror_t::vertical : Mapper::mirror_t::horizontal;
+  const bool newIsBatteryBacked = rom[6].bit(1);
+  const bool newHasTrainer = rom[6].bit(2);
+  const auto newMapperNumber = static_cast<uint8>((rom[6] >> 4) | (rom[7] & 0xf0));
+  const bool newIsNesV2 = (rom[7] & 0x0c) == 0x08;
 
-  if (hasTrainer) {
+  // Four-screen VRAM overrides the mapper's mirroring
+  if (rom[6].bit(3)) {
+    newMirrorType = Mapper::mirror_t::fourScreen;
+  }
+
+  if (newHasTrainer) {
     // TODO: trainers not supported for now
     return false;
   }
@@ -36,8 +50,8 @@ bool Cartridge::LoadRom(const void *romData, size_t romDataSize) {
   // TODO improve iNES header processing
 
   // Get the size of the PRG-ROM and CHR-ROM sections in bytes
-  const auto prgRomSize = prgRom16KUnits * 0x4000;
-  const auto chrRomSize = chrRom8KUnits * 0x2000;
+  const auto prgRomSize = newPrgRom16KUnits * 0x4000;
+  const auto chrRomSize = newChrRom8KUnits * 0x2000;
 
   // Calculate the expected size of the ROM file (including header)
   const size_t expectedRomSize = 16 + prgRomSize + chrRomSize;
@@ -57,31 +71,66 @@ bool Cartridge::LoadRom(const void *romData, size_t romDataSize) {
     chrRom.assign(rom.begin() + startOffset, rom.begin() + startOffset + chrRomSize);
   }
 
-  switch (mapperNumber) {
+  // Likewise for the mapper, since the emulator still points into the current one's memory
+  Mapper::ptr_t newMapper;
+  switch (newMapperNumber) {
   case 0:
-    mapper = Mapper0::Create(prgRom, chrRom, mirrorType);
+    newMapper = Mapper0::Create(prgRom, chrRom, newMirrorType);
     break;
 
   case 1:
     // TODO: does mirror type matter for MMC1?
-    mapper = Mapper1::Create(prgRom, chrRom);
+    newMapper = Mapper1::Create(prgRom, chrRom);
+    break;
+
+  case 2:
+    newMapper = Mapper2::Create(prgRom, chrRom, newMirrorType);
     break;
 
   case 3:
-    mapper = Mapper3::Create(prgRom, chrRom, mirrorType);
+    newMapper = Mapper3::Create(prgRom, chrRom, newMirrorType);
     break;
 
   case 4:
     // TODO is mirrorType necessary?
-    mapper = Mapper4::Create(prgRom, chrRom, mirrorType);
+    newMapper = Mapper4::Create(prgRom, chrRom, newMirrorType);
+    break;
+
+  case 7:
+    // The mapper selects the mirroring
+    newMapper = Mapper7::Create(prgRom, chrRom);
+    break;
+
+  case 11:
+    newMapper = Mapper11::Create(prgRom, chrRom, newMirrorType);
+    break;
+
+  case 66:
+    newMapper = Mapper66::Create(prgRom, chrRom, newMirrorType);
     break;
 
   default:
     // Unknown or unimplemented mapper
-    printf("TODO: unsupported mapper %d\n", (int)mapperNumber);
+    printf("TODO: unsupported mapper %d\n", (int)newMapperNumber);
     return false;
   }
 
+  if (!newMapper) {
+    // The mapper rejected the ROM (e.g., invalid PRG-ROM or CHR-ROM sizes)
+    return false;
+  }
+
+  mapper = std::move(newMapper);
+  prgRom16KUnits = newPrgRom16KUnits;
+  chrRom8KUnits = newChrRom8KUnits;
+  mirrorType = newMirrorType;
+  isBatteryBacked = newIsBatteryBacked;
+  hasTrainer = newHasTrainer;
+  mapperNumber = newMapperNumber;
+  isNesV2 = newIsNesV2;
+
+  ++chrGeneration;
+
   // Calculate ROM hashes
   crc32Hash = crc32(&rom[16], rom.size() - 16);
   md5Hash = md5(&rom[16], rom.size() - 16);
@@ -105,6 +154,10 @@ bool Cartridge::LoadBatteryBackedRAM(const void *ramData, size_t ramDataSize) {
 }
 
 Mapper::mirror_t Cartridge::GetMirrorType() const {
+  if (mirrorType == Mapper::mirror_t::fourScreen) {
+    return mirrorType;
+  }
+
   if (mapper) {
     return mapper->GetMirrorType();
   }
@@ -120,6 +173,11 @@ uint8 Cartridge::ReadPRG(uint16 address) {
   }
 
   if (address < 0x8000) {
+    if (mapper && !mapper->isWorkRamEnabled) {
+      // Open bus, which usually still holds the high byte of the address
+      return address >> 8;
+    }
+
     return workRam[address - 0x6000];
   }
 
@@ -138,7 +196,10 @@ void Cartridge::WritePRG(uint16 address, uint8 value) {
   }
 
   if (address < 0x8000) {
-    workRam[address - 0x6000] = value;
+    if (!mapper || mapper->isWorkRamWritable) {
+      workRam[address - 0x6000] = value;
+    }
+
     return;
   }
 
@@ -158,6 +219,24 @@ uint8 Cartridge::ReadCHR(uint16 address) {
 void Cartridge::WriteCHR(uint16 address, uint8 value) {
   if (mapper) {
     mapper->WriteCHR(address, value);
+    ++chrGeneration;
+  }
+}
+
+void Cartridge::Serialize(Serializer &serializer) {
+  serializer(workRam);
+
+  if (mirrorType == Mapper::mirror_t::fourScreen) {
+    serializer(fourScreenVram);
+  }
+
+  if (mapper) {
+    mapper->Serialize(serializer);
+  }
+
+  if (serializer.IsLoading()) {
+    // CHR-RAM and the CHR banks may have changed
+    ++chrGeneration;
   }
 }
 
@@ -2,24 +2,30 @@
 #include <utility>
 
 #include "nesturbia/cpu.hpp"
+#include "nesturbia/nesturbia.hpp"
 
 namespace nesturbia {
 
 namespace {
 
-extern const std::array<void (*)(Cpu &), 256> instructions;
-
-constexpr std::array<uint8_t, 32> kLengthCounterLookupTable = {
-    10, 254, 20, 2,  40, 4,  80, 6,  160, 8,  60, 10, 14, 12, 26, 14,
-    12, 16,  24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30};
+template <typename Bus> struct Instructions;
 
 } // namespace
 
-Cpu::Cpu(read_callback_t readCallback, write_callback_t writeCallback, tick_callback_t tickCallback)
-    : readCallback(std::move(readCallback)), writeCallback(std::move(writeCallback)),
-      tickCallback(std::move(tickCallback)) {}
+template <typename Bus> Cpu<Bus>::Cpu(Bus bus) : bus(std::move(bus)) {
+  apu.dmcRead = dmcRead;
+  apu.dmcReadContext = this;
+}
+
+template <>
+Cpu<CpuCallbackBus>::Cpu(read_callback_t readCallback, write_callback_t writeCallback,
+                         tick_callback_t tickCallback)
+    : bus{std::move(readCallback), std::move(writeCallback), std::move(tickCallback)} {
+  apu.dmcRead = dmcRead;
+  apu.dmcReadContext = this;
+}
 
-void Cpu::Power() {
+template <typename Bus> void Cpu<Bus>::Power() {
   A = 0x00;
   X = 0x00;
   Y = 0x00;
@@ -28,23 +34,15 @@ void Cpu::Power() {
   P = 0x4;
 
   cycles = 7;
+  instructions = 0;
 
   nmi = false;
-  irq = false;
-
-  // APU-specific
-  frameCounter.resetShiftRegisterTicks = 0;
-  frameCounter.shiftRegister = 0x7fff;
-  frameCounter.interruptInhibit = false;
-  frameCounter.mode = false;
-  frameCounter.interruptFlag = 0;
-
-  // TODO: should the APU run while the CPU resets?
-  // This is technically 'even' if 7 cycles ran during a reset
-  isOddCycle = false;
+  irq = 0;
+
+  apu.Power();
 }
 
-void Cpu::Reset() {
+template <typename Bus> void Cpu<Bus>::Reset() {
   // Registers A, X, and Y are unaffected by a reset
   // S (the stack pointer) is decremented by 3, but nothing is written to the stack
   S -= 3;
@@ -62,489 +60,100 @@ void Cpu::Reset() {
   // TODO: Most APU's have their frame counter reset - see NESDEV
 }
 
-void Cpu::NMI() { nmi = true; }
+template <typename Bus> void Cpu<Bus>::NMI() { nmi = true; }
 
-void Cpu::IRQ() { irq = true; }
+template <typename Bus> void Cpu<Bus>::IRQ(irq_source_t source) {
+  irq |= static_cast<uint8_t>(source);
+}
 
-void Cpu::SetSampleCallback(sample_callback_t sampleCallback, uint32_t sampleRate) {
-  this->sampleCallback = sampleCallback;
+template <typename Bus> void Cpu<Bus>::AcknowledgeIRQ(irq_source_t source) {
+  irq &= ~static_cast<uint8_t>(source);
+}
+
+template <typename Bus> void Cpu<Bus>::Serialize(Serializer &serializer) {
+  serializer(A);
+  serializer(X);
+  serializer(Y);
+  serializer(S);
+  serializer(PC);
+  serializer(P);
+  serializer(cycles);
+  serializer(instructions);
+  serializer(nmi);
+  serializer(irq);
 
-  // TODO: document where these numbers came from
-  ticksPerSample = 89341.5 / 3.0 * 60.0 / sampleRate;
+  apu.Serialize(serializer);
 }
 
-uint8 Cpu::read(uint16 address) {
+template <typename Bus> uint8 Cpu<Bus>::read(uint16 address) {
   tick();
 
-  if (address >= 0x4000 && address < 0x4015) {
-    // Write-only APU registers
-    return 0;
+  // Most reads are from outside of $4000-$401f, so those only need this one check
+  if ((address & 0xffe0) != 0x4000) {
+    return bus.Read(address);
   }
 
   if (address == 0x4015) {
-    // APU status register
-    uint8 value = 0;
-
-    value |= (pulseChannels[0].length.value != 0) << 0;
-    value |= (pulseChannels[1].length.value != 0) << 1;
-    value |= (triangleChannel.length.value != 0) << 2;
-    value |= (noiseChannel.length.value != 0) << 3;
-
-    // TODO: is this correct?
-    value |= (dmcChannel.length != 0) << 4;
-
-    value |= (frameCounter.interruptFlag != 0) << 6;
-    if (frameCounter.interruptFlag != 1) {
-      frameCounter.interruptFlag = 0;
-    }
-
-    // TODO: bit 7
-
-    return value;
+    return apu.ReadStatus();
   }
 
-  if (address > 0x4017 && address < 0x4020) {
-    // Write-only APU registers
-    return 0;
+  if (address == 0x4016 || address == 0x4017) {
+    // Joypads
+    return bus.Read(address);
   }
 
-  if (!readCallback) {
-    return 0;
-  }
-
-  return readCallback(address);
+  // Write-only APU registers
+  return 0;
 }
 
-uint16 Cpu::read16(uint16 address) {
+template <typename Bus> uint16 Cpu<Bus>::read16(uint16 address) {
   return read(address) | (read(static_cast<uint16>(address + 1)) << 8);
 }
 
-void Cpu::write(uint16 address, uint8 value) {
+template <typename Bus> void Cpu<Bus>::write(uint16 address, uint8 value) {
   tick();
 
-  auto &pulseChannel = pulseChannels[static_cast<uint8>(address.bit(2))];
-
-  switch (address) {
-  case 0x4000:
-  case 0x4004:
-    pulseChannel.duty = (value.bit(7) << 1) | value.bit(6);
-    pulseChannel.length.halt = value.bit(5);
-    pulseChannel.envelope.loop = value.bit(5);
-    pulseChannel.envelope.disabled = value.bit(4);
-    pulseChannel.envelope.volume = value & 0xf;
-    return;
-
-  case 0x4001:
-  case 0x4005:
-    pulseChannel.sweep.enabled = value.bit(7);
-    pulseChannel.sweep.period = ((value >> 4) & 0x7) + 1;
-    pulseChannel.sweep.negate = value.bit(3);
-    pulseChannel.sweep.shiftAmount = value & 0x7;
-
-    // Side effect: set the reload flag
-    pulseChannel.sweep.reload = true;
-
-    // TODO double-check this
-    pulseChannel.envelope.reload = true;
-    return;
-
-  case 0x4002:
-  case 0x4006:
-    pulseChannel.period &= 0x700;
-    pulseChannel.period |= value;
-    return;
-
-  case 0x4003:
-  case 0x4007:
-    pulseChannel.period &= 0x0ff;
-    pulseChannel.period |= (value & 0x7) << 8;
-
-    // Length counter load (L) - only when channel enabled via $4015 register
-    if (pulseChannel.enabled) {
-      pulseChannel.length.value = kLengthCounterLookupTable[value >> 3];
-    }
-
-    // Side effect: Reset the 3-bit ([0-7]) index into the duty cycle table
-    pulseChannel.dutyIndex = 0;
-
-    // Side effect: Reload the pulse channel envelope next APU tick
-    pulseChannel.envelope.reload = true;
-    return;
-
-  case 0x4008:
-    triangleChannel.length.halt = value.bit(7);
-    triangleChannel.linearCounter.load = value & 0x7f;
-    return;
-
-  case 0x4009:
-    // No-op
-    return;
-
-  case 0x400a:
-    // Timer (T) low
-    triangleChannel.period &= 0x700;
-    triangleChannel.period |= value;
-    return;
-
-  case 0x400b: {
-    // Timer (T) high (top 3 bits)
-    triangleChannel.period &= 0x0ff;
-    triangleChannel.period |= (value & 0x7) << 8;
-
-    triangleChannel.timerCounter = triangleChannel.period;
-
-    // Length counter load (L)
-    if (triangleChannel.enabled) {
-      triangleChannel.length.value = kLengthCounterLookupTable[value >> 3];
-    }
-
-    // Reload the linear counter
-    triangleChannel.linearCounter.reload = true;
-
-    // Clear the duty cycle index
-    triangleChannel.dutyIndex = 0;
-  }
-    return;
-
-  case 0x400c:
-    noiseChannel.length.halt = value.bit(5);
-    noiseChannel.envelope.loop = value.bit(5);
-    noiseChannel.envelope.disabled = value.bit(4);
-    noiseChannel.envelope.volume = value & 0xf;
-    noiseChannel.envelope.count = value & 0xf;
-
-    // TODO double-check this
-    noiseChannel.envelope.reload = true;
-    return;
-
-  case 0x400d:
-    // No-op
-    return;
-
-  case 0x400e: {
-    noiseChannel.mode = value.bit(7);
-
-    // TODO move somewhere else?
-    constexpr std::array<uint16_t, 16> kNoisePeriod = {4,   8,   16,  32,  64,  96,   128,  160,
-                                                       202, 254, 380, 508, 762, 1016, 2034, 4068};
-
-    noiseChannel.period = kNoisePeriod[value & 0xf];
-    return;
-  }
-
-  case 0x400f:
-    // Length counter load (L)
-    if (noiseChannel.enabled) {
-      noiseChannel.length.value = kLengthCounterLookupTable[value >> 3];
-    }
-
-    // Side effect: Reload the noise channel envelope next APU tick
-    noiseChannel.envelope.reload = true;
-    return;
-
-  case 0x4010: {
-    dmcChannel.irqEnabled = value.bit(7);
-    dmcChannel.loop = value.bit(6);
-
-    // TODO move somewhere else?
-    constexpr std::array<uint16_t, 16> kDmcPeriod = {214, 190, 170, 160, 143, 127, 113, 107,
-                                                     95,  80,  71,  64,  53,  42,  36,  27};
-
-    dmcChannel.period = kDmcPeriod[value & 0xf];
-    return;
-  }
-
-  case 0x4011:
-    dmcChannel.value = value & 0x7f;
-    return;
-
-  case 0x4012:
-    dmcChannel.sampleAddress = 0xc000 | (value << 6);
-    return;
-
-  case 0x4013:
-    dmcChannel.sampleLength = (value << 4) | 0x1;
-    return;
-
-  case 0x4015:
-    dmcChannel.enabled = value.bit(4);
-    if (!dmcChannel.enabled) {
-      dmcChannel.length = 0;
-    } else if (dmcChannel.length == 0) {
-      dmcChannel.address = dmcChannel.sampleAddress;
-      dmcChannel.length = dmcChannel.sampleLength;
-    }
-
-    noiseChannel.enabled = value.bit(3);
-    if (!noiseChannel.enabled) {
-      noiseChannel.length.value = 0;
-    }
-
-    triangleChannel.enabled = value.bit(2);
-    if (!triangleChannel.enabled) {
-      triangleChannel.length.value = 0;
-    }
-
-    pulseChannels[1].enabled = value.bit(1);
-    if (!pulseChannels[1].enabled) {
-      pulseChannels[1].length.value = 0;
-    }
-
-    pulseChannels[0].enabled = value.bit(0);
-    if (!pulseChannels[0].enabled) {
-      pulseChannels[0].length.value = 0;
-    }
-    return;
-
-  case 0x4017:
-    frameCounter.mode = value.bit(7);
-
-    frameCounter.interruptInhibit = value.bit(6);
-    if (frameCounter.interruptInhibit) {
-      frameCounter.interruptFlag = 0;
-    }
-
-    // TODO: NESDEV says that timer is reset 3 to 4 cycles after this register is written
-    frameCounter.resetShiftRegisterTicks = 2;
-
-    // Quarter/half frame signals are generated if mode flag is set during this register write
-    if (frameCounter.mode) {
-      apuQuarterFrame();
-      apuHalfFrame();
-    }
-    return;
-
-  case 0x4018:
-  case 0x4019:
-  case 0x401a:
-  case 0x401b:
-  case 0x401c:
-  case 0x401d:
-  case 0x401e:
-  case 0x401f:
-    // Used for CPU test mode (normally disabled)
+  // APU registers ($4014 is OAM DMA, and $4016 is the joypad strobe)
+  if ((address & 0xffe0) == 0x4000 && address != 0x4014 && address != 0x4016) {
+    apu.WriteRegister(address, value);
     return;
   }
 
-  if (writeCallback) {
-    writeCallback(address, value);
-  }
+  bus.Write(address, value);
 }
 
-void Cpu::write16(uint16 address, uint16 value) {
-  writeCallback(address, static_cast<uint8>(value));
-  writeCallback((uint16)(address + 1), static_cast<uint8>(value >> 8));
+template <typename Bus> void Cpu<Bus>::write16(uint16 address, uint16 value) {
+  bus.Write(address, static_cast<uint8>(value));
+  bus.Write((uint16)(address + 1), static_cast<uint8>(value >> 8));
 }
 
-uint8 Cpu::pop() { return read(0x100 + ++S); }
+template <typename Bus> uint8 Cpu<Bus>::pop() { return read(0x100 + ++S); }
 
-uint16 Cpu::pop16() { return pop() | (static_cast<uint16>(pop()) << 8); }
+template <typename Bus> uint16 Cpu<Bus>::pop16() {
+  return pop() | (static_cast<uint16>(pop()) << 8);
+}
 
-void Cpu::push(uint8 value) { write(0x100 + S--, value); }
+template <typename Bus> void Cpu<Bus>::push(uint8 value) { write(0x100 + S--, value); }
 
-void Cpu::push16(uint16 value) {
+template <typename Bus> void Cpu<Bus>::push16(uint16 value) {
   push(value >> 8);
   push(value);
 }
 
-void Cpu::tick() {
+template <typename Bus> void Cpu<Bus>::tick() {
   ++cycles;
-  if (tickCallback) {
-    tickCallback();
-  }
-
-  // TODO: move into its own function?
-  if (isOddCycle) {
-    if (frameCounter.resetShiftRegisterTicks != 0 &&
-        (--frameCounter.resetShiftRegisterTicks == 0)) {
-      frameCounter.shiftRegister = 0x7fff;
-    } else {
-      // 14-bit linear feedback shift register
-      // The top two bits are XORed and put into bit 0
-      // The rest of the bits are shifted by one
-      frameCounter.shiftRegister =
-          ((frameCounter.shiftRegister << 1) & 0x7ffe) |
-          (frameCounter.shiftRegister.bit(14) ^ frameCounter.shiftRegister.bit(13));
-    }
-
-    const auto isStep1 = frameCounter.shiftRegister == 0x1061;
-    const auto isStep2 = frameCounter.shiftRegister == 0x3603;
-    const auto isStep3 = frameCounter.shiftRegister == 0x2cd3;
-    const auto isStep4 = (!frameCounter.mode && frameCounter.shiftRegister == 0x0a1f) ||
-                         frameCounter.shiftRegister == 0x7185;
-
-    // Quarter frames occur every step
-    if (isStep1 || isStep2 || isStep3 || isStep4) {
-      apuQuarterFrame();
-    }
-
-    // Half frames occur on step 2 and 4
-    if (isStep2 || isStep4) {
-      apuHalfFrame();
-    }
-
-    // Set the IRQ on step 4 (mode 0 only)
-    // TODO the IRQ is set continuously in this condition, not just in this tick
-    if (isStep4 && !frameCounter.mode && !frameCounter.interruptInhibit) {
-      IRQ();
-      frameCounter.interruptFlag = 1;
-    } else if (frameCounter.interruptFlag) {
-      frameCounter.interruptFlag = 2;
-    }
-
-    // Flag that the shift register should reset from step 4
-    if (isStep4) {
-      frameCounter.resetShiftRegisterTicks = 2;
-    }
-
-    // TODO should this be on even cycles?
-    // Pulse channel code that's executed every APU cycle
-    for (auto &pulse : pulseChannels) {
-      if (pulse.timerCounter == 0) {
-        pulse.timerCounter = pulse.period;
-
-        // 3-bit value that wraps around
-        pulse.dutyIndex = (pulse.dutyIndex - 1) & 0x7;
-      } else {
-        --pulse.timerCounter;
-      }
-    }
+  bus.Tick();
 
-    // Noise channel timer
-    if (noiseChannel.timerCounter == 0) {
-      noiseChannel.timerCounter = noiseChannel.period;
-
-      const auto bit0 = noiseChannel.shiftRegister.bit(0);
-      const auto bit1 = noiseChannel.shiftRegister.bit(noiseChannel.mode ? 6 : 1);
-
-      noiseChannel.shiftRegister >>= 1;
-      noiseChannel.shiftRegister |= (bit0 ^ bit1) << 14;
-    } else {
-      --noiseChannel.timerCounter;
-    }
-
-    // DMC channel timer
-    if (dmcChannel.enabled) {
-      if (dmcChannel.length != 0 && dmcChannel.bitCount == 0) {
-        // TODO: CPU stall?
-        // BQS TODO add a 'peek' to prevent infinite recursion
-        dmcChannel.shiftRegister = readCallback(dmcChannel.address++);
-        dmcChannel.bitCount = 8;
-
-        if (dmcChannel.address == 0) {
-          dmcChannel.address = 0x8000;
-        }
-
-        --dmcChannel.length;
-        if (dmcChannel.length == 0 && dmcChannel.loop) {
-          dmcChannel.address = dmcChannel.sampleAddress;
-          dmcChannel.length = dmcChannel.sampleLength;
-        }
-      }
-
-      if (dmcChannel.tickValue == 0) {
-        dmcChannel.tickValue = dmcChannel.period;
-
-        if (dmcChannel.bitCount != 0) {
-          if (dmcChannel.shiftRegister.bit(0)) {
-            if (dmcChannel.value <= 125) {
-              dmcChannel.value += 2;
-            }
-          } else {
-            if (dmcChannel.value >= 2) {
-              dmcChannel.value -= 2;
-            }
-          }
-
-          dmcChannel.shiftRegister >>= 1;
-          --dmcChannel.bitCount;
-        }
-      } else {
-        --dmcChannel.tickValue;
-      }
-    }
+  if (apu.Tick()) {
+    IRQ(irq_source_t::apu);
   }
+}
 
-  // Triangle channel code that's executed every CPU cycle
-  // (most APU channel code executes on an APU cycle, which is 2 CPU cycles)
-  if (triangleChannel.timerCounter == 0) {
-    triangleChannel.timerCounter = triangleChannel.period;
-
-    if (triangleChannel.length.value != 0 && triangleChannel.linearCounter.value != 0) {
-      // 5-bit value that wraps around
-      triangleChannel.dutyIndex = (triangleChannel.dutyIndex + 1) & 0x1f;
-    }
-  } else {
-    --triangleChannel.timerCounter;
-  }
-
-  isOddCycle = !isOddCycle;
-
-  static double sampleSum = 0;
-  static uint32_t numSamples = 0;
-
-  // Pulse output
-  for (auto &pulse : pulseChannels) {
-    if (!pulse.enabled || pulse.length.value == 0) {
-      continue;
-    }
-
-    // TODO move somewhere else?
-    constexpr std::array<uint8_t, 4> kPulseDuty = {0x40, 0x60, 0x78, 0x9f};
-    if (!uint8(kPulseDuty[pulse.duty]).bit(pulse.dutyIndex)) {
-      continue;
-    }
-
-    // TODO double check this
-    if (pulse.period < 8 || pulse.timerCounter > 0x7ff) {
-      continue;
-    }
-
-    // TODO: do proper mixing logic
-    sampleSum += 0.00752 * (pulse.envelope.disabled ? pulse.envelope.volume : pulse.envelope.count);
-  }
-
-  // Triangle output
-  if (triangleChannel.enabled && triangleChannel.length.value != 0 &&
-      triangleChannel.linearCounter.value != 0) {
-    // TODO move somewhere else?
-    constexpr std::array<uint8_t, 32> kTriangleTable = {15, 14, 13, 12, 11, 10, 9,  8,  7,  6, 5,
-                                                        4,  3,  2,  1,  0,  0,  1,  2,  3,  4, 5,
-                                                        6,  7,  8,  9,  10, 11, 12, 13, 14, 15};
-
-    // TODO: do proper mixing logic
-    sampleSum += 0.00851 * kTriangleTable.at(triangleChannel.dutyIndex);
-  }
-
-  // Noise output
-  if (noiseChannel.enabled && noiseChannel.length.value != 0 &&
-      !noiseChannel.shiftRegister.bit(0)) {
-    // TODO: do proper mixing logic
-    sampleSum += 0.00494 * (noiseChannel.envelope.disabled ? noiseChannel.envelope.volume
-                                                           : noiseChannel.envelope.count);
-  }
-
-  // DMC output
-  // TODO: do proper mixing logic
-  sampleSum += 0.00335 * dmcChannel.value;
-
-  ++numSamples;
-
-  static double elapsedCycles = 0.0;
-  if (++elapsedCycles > ticksPerSample) {
-    // New sample
-    elapsedCycles -= ticksPerSample;
-
-    if (sampleCallback) {
-      sampleCallback(sampleSum / numSamples / 4);
-    }
-
-    sampleSum = 0;
-    numSamples = 0;
-  }
+template <typename Bus> uint8 Cpu<Bus>::dmcRead(void *context, uint16 address) {
+  return static_cast<Cpu *>(context)->bus.Read(address);
 }
 
-void Cpu::executeInstruction() {
+template <typename Bus> void Cpu<Bus>::executeInstruction() {
   if (nmi) {
     nmi = false;
     push16(PC);
@@ -554,9 +163,9 @@ void Cpu::executeInstruction() {
     tick();
     tick();
     return;
-  } else if (irq && !P.I) {
+  } else if (irq != 0 && !P.I) {
     // TODO: double check this
-    irq = false;
+    irq = 0;
     push16(PC);
     push(P | 0x20);
     PC = read16(0xfffe);
@@ -566,653 +175,539 @@ void Cpu::executeInstruction() {
     return;
   }
 
+  ++instructions;
+
   const auto opcode = read(PC++);
-  instructions[opcode](*this);
+  Instructions<Bus>::table[opcode](*this);
 }
 
-void Cpu::apuQuarterFrame() {
-  // Pulse: envelopes
-  for (auto &pulse : pulseChannels) {
-    if (pulse.envelope.reload) {
-      pulse.envelope.reload = false;
-      pulse.envelope.divider = pulse.envelope.volume;
-      pulse.envelope.count = 0xf;
-    } else {
-      if (pulse.envelope.divider == 0) {
-        pulse.envelope.divider = pulse.envelope.volume;
-
-        if (pulse.envelope.count != 0 || pulse.envelope.loop) {
-          pulse.envelope.count = (pulse.envelope.count - 1) & 0xf;
-        }
-      } else {
-        --pulse.envelope.divider;
-      }
-    }
-  }
+namespace {
 
-  // Triangle: linear counter
-  if (triangleChannel.linearCounter.reload) {
-    triangleChannel.linearCounter.value = triangleChannel.linearCounter.load;
-  } else {
-    if (triangleChannel.linearCounter.value != 0) {
-      --triangleChannel.linearCounter.value;
-    }
-  }
+template <typename Bus> struct Instructions {
+  using cpu_t = Cpu<Bus>;
 
-  if (!triangleChannel.length.halt) {
-    // Disable reloading if bit 7 of $4008 is cleared
-    triangleChannel.linearCounter.reload = false;
+  // Helper functions
+  static bool checkPageCross(uint16 value, int8_t offset) {
+    return (((value + offset) & 0xff00) != (value & 0xff00));
   }
 
-  // Noise: envelope
-  if (noiseChannel.envelope.reload) {
-    noiseChannel.envelope.reload = false;
-    noiseChannel.envelope.divider = noiseChannel.envelope.volume;
-    noiseChannel.envelope.count = 0xf;
-  } else {
-    if (noiseChannel.envelope.divider == 0) {
-      noiseChannel.envelope.divider = noiseChannel.envelope.volume;
-
-      if (noiseChannel.envelope.count != 0 || noiseChannel.envelope.loop) {
-        noiseChannel.envelope.count = (noiseChannel.envelope.count - 1) & 0xf;
+  static void branch(cpu_t &cpu, bool takeBranch) {
+    const auto offset = static_cast<int8_t>(cpu.read(cpu.PC++));
+    if (takeBranch) {
+      if (checkPageCross(cpu.PC, offset)) {
+        cpu.tick();
       }
-    } else {
-      --noiseChannel.envelope.divider;
+
+      cpu.tick();
+      cpu.PC += offset;
     }
   }
-}
 
-void Cpu::apuHalfFrame() {
-  // Pulse: sweep + length counters
-  bool isPulse1 = true;
-  for (auto &pulse : pulseChannels) {
-    // Sweep
-    if (pulse.sweep.reload) {
-      // TODO this logic is duplicated below
-      if (pulse.sweep.enabled) {
-        pulse.sweep.divider = pulse.sweep.period;
-        if (pulse.sweep.enabled && pulse.sweep.shiftAmount != 0) {
-          auto periodShifted = pulse.period >> pulse.sweep.shiftAmount;
-          if (pulse.sweep.negate) {
-            // Get the one's complement (used by pulse 1)
-            periodShifted = ~periodShifted;
-            if (!isPulse1) {
-              // Pulse 2 uses the two's complement (one's complement + 1)
-              ++periodShifted;
-            }
-          }
-
-          pulse.period += periodShifted;
-        }
-      }
+  // Addressing modes
+  using addr_func_t = uint16 (*)(cpu_t &);
 
-      pulse.sweep.reload = false;
-      pulse.sweep.divider = pulse.sweep.period;
-    } else {
-      if (pulse.sweep.divider == 0) {
-        // TODO this logic is duplicated above
-        if (pulse.sweep.enabled) {
-          pulse.sweep.divider = pulse.sweep.period;
-          if (pulse.sweep.enabled && pulse.sweep.shiftAmount != 0) {
-            auto periodShifted = pulse.period >> pulse.sweep.shiftAmount;
-            if (pulse.sweep.negate) {
-              // Get the one's complement (used by pulse 1)
-              periodShifted = ~periodShifted;
-              if (!isPulse1) {
-                // Pulse 2 uses the two's complement (one's complement + 1)
-                ++periodShifted;
-              }
-            }
-
-            pulse.period += periodShifted;
-          }
-        }
-      } else {
-        --pulse.sweep.divider;
-      }
-    }
+  static uint16 addr_abs(cpu_t &cpu) { return cpu.read16((cpu.PC += 2) - 2); }
 
-    // Length counter
-    if (!pulse.length.halt && pulse.length.value != 0) {
-      --pulse.length.value;
+  template <bool CheckPageCross = true> static uint16 addr_abx(cpu_t &cpu) {
+    const auto v = addr_abs(cpu);
+
+    if constexpr (CheckPageCross) {
+      if (checkPageCross(v, cpu.X)) {
+        // A dummy read occurs here because (address + X) crosses a page boundary
+        // * The CPU adds (absolute address) and (register X) without an 8-bit carry
+        // * The CPU starts to fetch from the result of (address + X)
+        // * The CPU sees that it needs to factor in the carry into the upper 8 bits, and takes
+        //   another cycle to read the intended value
+        cpu.read((v & 0xff00) | ((v + cpu.X) & 0xff));
+      }
+    } else {
+      cpu.tick();
     }
 
-    isPulse1 = false;
+    return v + cpu.X;
   }
 
-  // Triangle: length counter
-  if (!triangleChannel.length.halt && triangleChannel.length.value != 0) {
-    --triangleChannel.length.value;
-  }
+  static uint16 addr_aby(cpu_t &cpu) {
+    const auto v = addr_abs(cpu);
 
-  // Noise: length counter
-  if (!noiseChannel.length.halt && noiseChannel.length.value != 0) {
-    --noiseChannel.length.value;
-  }
+    if (checkPageCross(v, cpu.Y)) {
+      cpu.tick();
+    }
 
-  // TODO other waveforms?
-}
+    return v + cpu.Y;
+  }
 
-namespace {
+  static uint16 addr_acc(cpu_t &) { return 0; }
 
-// Helper functions
-inline bool checkPageCross(uint16 value, int8_t offset) {
-  return (((value + offset) & 0xff00) != (value & 0xff00));
-}
+  static uint16 addr_imm(cpu_t &cpu) { return cpu.PC++; }
 
-inline void branch(Cpu &cpu, bool takeBranch) {
-  const auto offset = static_cast<int8_t>(cpu.read(cpu.PC++));
-  if (takeBranch) {
-    if (checkPageCross(cpu.PC, offset)) {
-      cpu.tick();
-    }
+  static uint16 addr_ind(cpu_t &cpu) {
+    const auto a = addr_abs(cpu);
+    const auto l = cpu.read(a);
+    const auto h = cpu.read((a & 0xff00) | ((a + 1) & 0x00ff));
+    return l | (h << 8);
+  }
 
+  static uint16 addr_inx(cpu_t &cpu) {
+    const auto l = static_cast<uint8>(cpu.read(cpu.PC++) + cpu.X);
+    const auto h = static_cast<uint8>(l + 1);
     cpu.tick();
-    cpu.PC += offset;
+    return cpu.read(l) | (cpu.read(h) << 8);
   }
-}
-
-// Addressing modes
-using addr_func_t = uint16 (*)(Cpu &);
-
-inline uint16 addr_abs(Cpu &cpu) { return cpu.read16((cpu.PC += 2) - 2); }
 
-template <bool CheckPageCross = true> inline uint16 addr_abx(Cpu &cpu) {
-  const auto v = addr_abs(cpu);
+  static uint16 addr_iny(cpu_t &cpu) {
+    const auto l = cpu.read(cpu.PC++);
+    const auto h = static_cast<uint8>(l + 1);
+    const auto v = static_cast<uint16>(cpu.read(l) | cpu.read(h) << 8);
 
-  if constexpr (CheckPageCross) {
-    if (checkPageCross(v, cpu.X)) {
-      // A dummy read occurs here because (address + X) crosses a page boundary
-      // * The CPU adds (absolute address) and (register X) without an 8-bit carry
-      // * The CPU starts to fetch from the result of (address + X)
+    if (checkPageCross(v, cpu.Y)) {
+      // A dummy read occurs here because (zero-page + Y) crosses a page boundary
+      // * The CPU adds (zero-page) and (register Y) without an 8-bit carry
+      // * The CPU starts to fetch from the result of (zero-page + Y)
       // * The CPU sees that it needs to factor in the carry into the upper 8 bits, and takes
       //   another cycle to read the intended value
-      cpu.read((v & 0xff00) | ((v + cpu.X) & 0xff));
+      cpu.read((v & 0xff00) | ((v + cpu.Y) & 0xff));
     }
-  } else {
-    cpu.tick();
+
+    return v + cpu.Y;
   }
 
-  return v + cpu.X;
-}
+  static uint16 addr_zpg(cpu_t &cpu) { return cpu.read(cpu.PC++); }
 
-inline uint16 addr_aby(Cpu &cpu) {
-  const auto v = addr_abs(cpu);
+  static uint16 addr_zpx(cpu_t &cpu) {
+    cpu.tick();
+    return (cpu.read(cpu.PC++) + cpu.X) & 0xff;
+  }
 
-  if (checkPageCross(v, cpu.Y)) {
+  static uint16 addr_zpy(cpu_t &cpu) {
     cpu.tick();
+    return (cpu.read(cpu.PC++) + cpu.Y) & 0xff;
   }
 
-  return v + cpu.Y;
-}
+  // Instructions/opcodes
+  using instr_func_t = void (*)(cpu_t &);
 
-inline uint16 addr_acc(Cpu &) { return 0; }
+  template <addr_func_t T> static void op_adc(cpu_t &cpu) {
+    const auto v = cpu.read(T(cpu));
+    const uint16 r16 = cpu.A + v + cpu.P.C;
+    const auto r = static_cast<uint8>(r16);
 
-inline uint16 addr_imm(Cpu &cpu) { return cpu.PC++; }
+    cpu.P.C = r16.bit(8);
+    cpu.P.Z = r == 0;
+    cpu.P.V = (~(cpu.A ^ v) & (cpu.A ^ r) & 0x80) != 0;
+    cpu.P.N = r.bit(7);
 
-inline uint16 addr_ind(Cpu &cpu) {
-  const auto a = addr_abs(cpu);
-  const auto l = cpu.read(a);
-  const auto h = cpu.read((a & 0xff00) | ((a + 1) & 0x00ff));
-  return l | (h << 8);
-}
+    cpu.A = r;
+  }
 
-inline uint16 addr_inx(Cpu &cpu) {
-  const auto l = static_cast<uint8>(cpu.read(cpu.PC++) + cpu.X);
-  const auto h = static_cast<uint8>(l + 1);
-  cpu.tick();
-  return cpu.read(l) | (cpu.read(h) << 8);
-}
+  template <addr_func_t T> static void op_and(cpu_t &cpu) {
+    cpu.A &= cpu.read(T(cpu));
 
-inline uint16 addr_iny(Cpu &cpu) {
-  const auto l = cpu.read(cpu.PC++);
-  const auto h = static_cast<uint8>(l + 1);
-  const auto v = static_cast<uint16>(cpu.read(l) | cpu.read(h) << 8);
-
-  if (checkPageCross(v, cpu.Y)) {
-    // A dummy read occurs here because (zero-page + Y) crosses a page boundary
-    // * The CPU adds (zero-page) and (register Y) without an 8-bit carry
-    // * The CPU starts to fetch from the result of (zero-page + Y)
-    // * The CPU sees that it needs to factor in the carry into the upper 8 bits, and takes
-    //   another cycle to read the intended value
-    cpu.read((v & 0xff00) | ((v + cpu.Y) & 0xff));
+    cpu.P.Z = cpu.A == 0;
+    cpu.P.N = cpu.A.bit(7);
   }
 
-  return v + cpu.Y;
-}
+  template <addr_func_t T> static void op_asl(cpu_t &cpu) {
+    cpu.tick();
 
-inline uint16 addr_zpg(Cpu &cpu) { return cpu.read(cpu.PC++); }
+    if (T == addr_acc) {
+      const auto r = static_cast<uint8>(cpu.A << 1);
 
-inline uint16 addr_zpx(Cpu &cpu) {
-  cpu.tick();
-  return (cpu.read(cpu.PC++) + cpu.X) & 0xff;
-}
+      cpu.P.C = cpu.A.bit(7);
+      cpu.P.Z = r == 0;
+      cpu.P.N = r.bit(7);
 
-inline uint16 addr_zpy(Cpu &cpu) {
-  cpu.tick();
-  return (cpu.read(cpu.PC++) + cpu.Y) & 0xff;
-}
+      cpu.A = r;
+    } else {
+      const auto address = T(cpu);
+      const auto v = cpu.read(address);
+      const auto r = static_cast<uint8>(v << 1);
 
-// Instructions/opcodes
-using instr_func_t = void (*)(Cpu &);
+      cpu.P.C = v.bit(7);
+      cpu.P.Z = r == 0;
+      cpu.P.N = r.bit(7);
 
-template <addr_func_t T> static void op_adc(Cpu &cpu) {
-  const auto v = cpu.read(T(cpu));
-  const uint16 r16 = cpu.A + v + cpu.P.C;
-  const auto r = static_cast<uint8>(r16);
+      cpu.write(address, r);
+    }
+  }
 
-  cpu.P.C = r16.bit(8);
-  cpu.P.Z = r == 0;
-  cpu.P.V = (~(cpu.A ^ v) & (cpu.A ^ r) & 0x80) != 0;
-  cpu.P.N = r.bit(7);
+  static void op_bcc(cpu_t &cpu) { branch(cpu, !cpu.P.C); }
 
-  cpu.A = r;
-}
+  static void op_bcs(cpu_t &cpu) { branch(cpu, cpu.P.C); }
 
-template <addr_func_t T> static void op_and(Cpu &cpu) {
-  cpu.A &= cpu.read(T(cpu));
+  static void op_beq(cpu_t &cpu) { branch(cpu, cpu.P.Z); }
 
-  cpu.P.Z = cpu.A == 0;
-  cpu.P.N = cpu.A.bit(7);
-}
+  template <addr_func_t T> static void op_bit(cpu_t &cpu) {
+    const auto v = cpu.read(T(cpu));
 
-template <addr_func_t T> static void op_asl(Cpu &cpu) {
-  cpu.tick();
+    cpu.P.Z = static_cast<uint8>(v & cpu.A) == 0;
+    cpu.P.V = v.bit(6);
+    cpu.P.N = v.bit(7);
+  }
 
-  if (T == addr_acc) {
-    const auto r = static_cast<uint8>(cpu.A << 1);
+  static void op_bmi(cpu_t &cpu) { branch(cpu, cpu.P.N); }
 
-    cpu.P.C = cpu.A.bit(7);
-    cpu.P.Z = r == 0;
-    cpu.P.N = r.bit(7);
+  static void op_bne(cpu_t &cpu) { branch(cpu, !cpu.P.Z); }
 
-    cpu.A = r;
-  } else {
-    const auto address = T(cpu);
-    const auto v = cpu.read(address);
-    const auto r = static_cast<uint8>(v << 1);
+  static void op_bpl(cpu_t &cpu) { branch(cpu, !cpu.P.N); }
 
-    cpu.P.C = v.bit(7);
-    cpu.P.Z = r == 0;
-    cpu.P.N = r.bit(7);
-
-    cpu.write(address, r);
+  static void op_brk(cpu_t &cpu) {
+    // Dummy read
+    // TODO: other instructions can cause dummy reads (PHP, PLP, etc.)?
+    cpu.read(cpu.PC++);
+    cpu.push16(cpu.PC);
+    cpu.push(cpu.P | 0x30);
+    cpu.PC = cpu.read16(0xfffe);
+    cpu.P.I = true;
   }
-}
-
-static void op_bcc(Cpu &cpu) { branch(cpu, !cpu.P.C); }
 
-static void op_bcs(Cpu &cpu) { branch(cpu, cpu.P.C); }
+  static void op_bvc(cpu_t &cpu) { branch(cpu, !cpu.P.V); }
 
-static void op_beq(Cpu &cpu) { branch(cpu, cpu.P.Z); }
+  static void op_bvs(cpu_t &cpu) { branch(cpu, cpu.P.V); }
 
-template <addr_func_t T> static void op_bit(Cpu &cpu) {
-  const auto v = cpu.read(T(cpu));
-
-  cpu.P.Z = static_cast<uint8>(v & cpu.A) == 0;
-  cpu.P.V = v.bit(6);
-  cpu.P.N = v.bit(7);
-}
+  static void op_clc(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.C = false;
+  }
 
-static void op_bmi(Cpu &cpu) { branch(cpu, cpu.P.N); }
+  static void op_cld(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.D = false;
+  }
 
-static void op_bne(Cpu &cpu) { branch(cpu, !cpu.P.Z); }
+  static void op_cli(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.I = false;
+  }
 
-static void op_bpl(Cpu &cpu) { branch(cpu, !cpu.P.N); }
+  static void op_clv(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.V = false;
+  }
 
-static void op_brk(Cpu &cpu) {
-  // Dummy read
-  // TODO: other instructions can cause dummy reads (PHP, PLP, etc.)?
-  cpu.read(cpu.PC++);
-  cpu.push16(cpu.PC);
-  cpu.push(cpu.P | 0x30);
-  cpu.PC = cpu.read16(0xfffe);
-  cpu.P.I = true;
-}
+  template <addr_func_t T> static void op_cmp(cpu_t &cpu) {
+    const auto v = cpu.read(T(cpu));
+    const auto r = static_cast<uint8>(cpu.A - v);
 
-static void op_bvc(Cpu &cpu) { branch(cpu, !cpu.P.V); }
+    cpu.P.C = cpu.A >= v;
+    cpu.P.Z = (r == 0);
+    cpu.P.N = r.bit(7);
+  }
 
-static void op_bvs(Cpu &cpu) { branch(cpu, cpu.P.V); }
+  template <addr_func_t T> static void op_cpx(cpu_t &cpu) {
+    const auto v = cpu.read(T(cpu));
+    const auto r = static_cast<uint8>(cpu.X - v);
 
-static void op_clc(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.C = false;
-}
+    cpu.P.C = cpu.X >= v;
+    cpu.P.Z = (r == 0);
+    cpu.P.N = r.bit(7);
+  }
 
-static void op_cld(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.D = false;
-}
+  template <addr_func_t T> static void op_cpy(cpu_t &cpu) {
+    const auto v = cpu.read(T(cpu));
+    const auto r = static_cast<uint8>(cpu.Y - v);
 
-static void op_cli(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.I = false;
-}
+    cpu.P.C = cpu.Y >= v;
+    cpu.P.Z = (r == 0);
+    cpu.P.N = r.bit(7);
+  }
 
-static void op_clv(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.V = false;
-}
+  template <addr_func_t T> static void op_dec(cpu_t &cpu) {
+    const auto a = T(cpu);
+    const auto v = static_cast<uint8>(cpu.read(a) - 1);
 
-template <addr_func_t T> static void op_cmp(Cpu &cpu) {
-  const auto v = cpu.read(T(cpu));
-  const auto r = static_cast<uint8>(cpu.A - v);
+    cpu.tick();
 
-  cpu.P.C = cpu.A >= v;
-  cpu.P.Z = (r == 0);
-  cpu.P.N = r.bit(7);
-}
+    cpu.P.Z = (v == 0);
+    cpu.P.N = v.bit(7);
 
-template <addr_func_t T> static void op_cpx(Cpu &cpu) {
-  const auto v = cpu.read(T(cpu));
-  const auto r = static_cast<uint8>(cpu.X - v);
+    cpu.write(a, v);
+  }
 
-  cpu.P.C = cpu.X >= v;
-  cpu.P.Z = (r == 0);
-  cpu.P.N = r.bit(7);
-}
+  static void op_dex(cpu_t &cpu) {
+    cpu.tick();
+    --cpu.X;
 
-template <addr_func_t T> static void op_cpy(Cpu &cpu) {
-  const auto v = cpu.read(T(cpu));
-  const auto r = static_cast<uint8>(cpu.Y - v);
+    cpu.P.Z = (cpu.X == 0);
+    cpu.P.N = cpu.X.bit(7);
+  }
 
-  cpu.P.C = cpu.Y >= v;
-  cpu.P.Z = (r == 0);
-  cpu.P.N = r.bit(7);
-}
+  static void op_dey(cpu_t &cpu) {
+    cpu.tick();
+    --cpu.Y;
 
-template <addr_func_t T> static void op_dec(Cpu &cpu) {
-  const auto a = T(cpu);
-  const auto v = static_cast<uint8>(cpu.read(a) - 1);
+    cpu.P.Z = (cpu.Y == 0);
+    cpu.P.N = cpu.Y.bit(7);
+  }
 
-  cpu.tick();
+  template <addr_func_t T> static void op_eor(cpu_t &cpu) {
+    cpu.A ^= cpu.read(T(cpu));
 
-  cpu.P.Z = (v == 0);
-  cpu.P.N = v.bit(7);
+    cpu.P.Z = cpu.A == 0;
+    cpu.P.N = cpu.A.bit(7);
+  }
 
-  cpu.write(a, v);
-}
+  template <addr_func_t T> static void op_inc(cpu_t &cpu) {
+    const auto a = T(cpu);
+    const auto v = static_cast<uint8>(cpu.read(a) + 1);
 
-static void op_dex(Cpu &cpu) {
-  cpu.tick();
-  --cpu.X;
+    cpu.tick();
 
-  cpu.P.Z = (cpu.X == 0);
-  cpu.P.N = cpu.X.bit(7);
-}
+    cpu.P.Z = (v == 0);
+    cpu.P.N = v.bit(7);
 
-static void op_dey(Cpu &cpu) {
-  cpu.tick();
-  --cpu.Y;
+    cpu.write(a, v);
+  }
 
-  cpu.P.Z = (cpu.Y == 0);
-  cpu.P.N = cpu.Y.bit(7);
-}
+  static void op_inx(cpu_t &cpu) {
+    cpu.tick();
+    ++cpu.X;
 
-template <addr_func_t T> static void op_eor(Cpu &cpu) {
-  cpu.A ^= cpu.read(T(cpu));
+    cpu.P.Z = (cpu.X == 0);
+    cpu.P.N = cpu.X.bit(7);
+  }
 
-  cpu.P.Z = cpu.A == 0;
-  cpu.P.N = cpu.A.bit(7);
-}
+  static void op_iny(cpu_t &cpu) {
+    cpu.tick();
+    ++cpu.Y;
 
-template <addr_func_t T> static void op_inc(Cpu &cpu) {
-  const auto a = T(cpu);
-  const auto v = static_cast<uint8>(cpu.read(a) + 1);
+    cpu.P.Z = (cpu.Y == 0);
+    cpu.P.N = cpu.Y.bit(7);
+  }
 
-  cpu.tick();
+  template <addr_func_t T> static void op_jmp(cpu_t &cpu) { cpu.PC = T(cpu); }
 
-  cpu.P.Z = (v == 0);
-  cpu.P.N = v.bit(7);
+  static void op_jsr(cpu_t &cpu) {
+    cpu.tick();
+    cpu.push16(cpu.PC + 1);
+    cpu.PC = addr_abs(cpu);
+  }
 
-  cpu.write(a, v);
-}
+  template <addr_func_t T> static void op_lda(cpu_t &cpu) {
+    cpu.A = cpu.read(T(cpu));
+    cpu.P.Z = (cpu.A == 0);
+    cpu.P.N = cpu.A.bit(7);
+  }
 
-static void op_inx(Cpu &cpu) {
-  cpu.tick();
-  ++cpu.X;
+  template <addr_func_t T> static void op_ldx(cpu_t &cpu) {
+    cpu.X = cpu.read(T(cpu));
 
-  cpu.P.Z = (cpu.X == 0);
-  cpu.P.N = cpu.X.bit(7);
-}
+    cpu.P.Z = (cpu.X == 0);
+    cpu.P.N = cpu.X.bit(7);
+  }
 
-static void op_iny(Cpu &cpu) {
-  cpu.tick();
-  ++cpu.Y;
+  template <addr_func_t T> static void op_ldy(cpu_t &cpu) {
+    cpu.Y = cpu.read(T(cpu));
 
-  cpu.P.Z = (cpu.Y == 0);
-  cpu.P.N = cpu.Y.bit(7);
-}
+    cpu.P.Z = (cpu.Y == 0);
+    cpu.P.N = cpu.Y.bit(7);
+  }
 
-template <addr_func_t T> static void op_jmp(Cpu &cpu) { cpu.PC = T(cpu); }
+  template <addr_func_t T> static void op_lsr(cpu_t &cpu) {
+    cpu.tick();
 
-static void op_jsr(Cpu &cpu) {
-  cpu.tick();
-  cpu.push16(cpu.PC + 1);
-  cpu.PC = addr_abs(cpu);
-}
+    if (T == addr_acc) {
+      const auto v = cpu.A;
+      const auto r = static_cast<uint8>(v >> 1);
 
-template <addr_func_t T> static void op_lda(Cpu &cpu) {
-  cpu.A = cpu.read(T(cpu));
-  cpu.P.Z = (cpu.A == 0);
-  cpu.P.N = cpu.A.bit(7);
-}
+      cpu.P.C = v.bit(0);
+      cpu.P.Z = r == 0;
+      cpu.P.N = false;
 
-template <addr_func_t T> static void op_ldx(Cpu &cpu) {
-  cpu.X = cpu.read(T(cpu));
+      cpu.A = r;
+    } else {
+      const auto address = T(cpu);
+      const auto v = cpu.read(address);
+      const auto r = static_cast<uint8>(v >> 1);
 
-  cpu.P.Z = (cpu.X == 0);
-  cpu.P.N = cpu.X.bit(7);
-}
+      cpu.P.C = v.bit(0);
+      cpu.P.Z = r == 0;
+      cpu.P.N = false;
 
-template <addr_func_t T> static void op_ldy(Cpu &cpu) {
-  cpu.Y = cpu.read(T(cpu));
+      cpu.write(address, r);
+    }
+  }
 
-  cpu.P.Z = (cpu.Y == 0);
-  cpu.P.N = cpu.Y.bit(7);
-}
+  static void op_nop(cpu_t &cpu) { cpu.tick(); }
 
-template <addr_func_t T> static void op_lsr(Cpu &cpu) {
-  cpu.tick();
+  template <addr_func_t T> static void op_ora(cpu_t &cpu) {
+    cpu.A |= cpu.read(T(cpu));
 
-  if (T == addr_acc) {
-    const auto v = cpu.A;
-    const auto r = static_cast<uint8>(v >> 1);
+    cpu.P.Z = cpu.A == 0;
+    cpu.P.N = cpu.A.bit(7);
+  }
 
-    cpu.P.C = v.bit(0);
-    cpu.P.Z = r == 0;
-    cpu.P.N = false;
+  static void op_pha(cpu_t &cpu) {
+    cpu.tick();
+    cpu.push(cpu.A);
+  }
 
-    cpu.A = r;
-  } else {
-    const auto address = T(cpu);
-    const auto v = cpu.read(address);
-    const auto r = static_cast<uint8>(v >> 1);
+  static void op_php(cpu_t &cpu) {
+    cpu.tick();
+    cpu.push(cpu.P | 0x30);
+  }
 
-    cpu.P.C = v.bit(0);
-    cpu.P.Z = r == 0;
-    cpu.P.N = false;
+  static void op_pla(cpu_t &cpu) {
+    cpu.tick();
+    cpu.tick();
+    cpu.A = cpu.pop();
 
-    cpu.write(address, r);
+    cpu.P.Z = (cpu.A == 0);
+    cpu.P.N = cpu.A.bit(7);
   }
-}
 
-static void op_nop(Cpu &cpu) { cpu.tick(); }
+  static void op_plp(cpu_t &cpu) {
+    cpu.tick();
+    cpu.tick();
+    cpu.P = cpu.pop();
+  }
 
-template <addr_func_t T> static void op_ora(Cpu &cpu) {
-  cpu.A |= cpu.read(T(cpu));
+  template <addr_func_t T> static void op_rol(cpu_t &cpu) {
+    cpu.tick();
 
-  cpu.P.Z = cpu.A == 0;
-  cpu.P.N = cpu.A.bit(7);
-}
+    if (T == addr_acc) {
+      const auto v = cpu.A;
+      const auto r = static_cast<uint8>((v << 1) | cpu.P.C);
 
-static void op_pha(Cpu &cpu) {
-  cpu.tick();
-  cpu.push(cpu.A);
-}
+      cpu.P.C = v.bit(7);
+      cpu.P.Z = r == 0;
+      cpu.P.N = r.bit(7);
 
-static void op_php(Cpu &cpu) {
-  cpu.tick();
-  cpu.push(cpu.P | 0x30);
-}
+      cpu.A = r;
+    } else {
+      const auto address = T(cpu);
+      const auto v = cpu.read(address);
+      const auto r = static_cast<uint8>((v << 1) | cpu.P.C);
 
-static void op_pla(Cpu &cpu) {
-  cpu.tick();
-  cpu.tick();
-  cpu.A = cpu.pop();
+      cpu.P.C = v.bit(7);
+      cpu.P.Z = r == 0;
+      cpu.P.N = r.bit(7);
 
-  cpu.P.Z = (cpu.A == 0);
-  cpu.P.N = cpu.A.bit(7);
-}
+      cpu.write(address, r);
+    }
+  }
 
-static void op_plp(Cpu &cpu) {
-  cpu.tick();
-  cpu.tick();
-  cpu.P = cpu.pop();
-}
+  template <addr_func_t T> static void op_ror(cpu_t &cpu) {
+    cpu.tick();
 
-template <addr_func_t T> static void op_rol(Cpu &cpu) {
-  cpu.tick();
+    if (T == addr_acc) {
+      const auto v = cpu.A;
+      const auto r = static_cast<uint8>((cpu.P.C << 7) | (v >> 1));
 
-  if (T == addr_acc) {
-    const auto v = cpu.A;
-    const auto r = static_cast<uint8>((v << 1) | cpu.P.C);
+      cpu.P.C = v.bit(0);
+      cpu.P.Z = r == 0;
+      cpu.P.N = r.bit(7);
 
-    cpu.P.C = v.bit(7);
-    cpu.P.Z = r == 0;
-    cpu.P.N = r.bit(7);
+      cpu.A = r;
+    } else {
+      const auto address = T(cpu);
+      const auto v = cpu.read(address);
+      const auto r = static_cast<uint8>((cpu.P.C << 7) | (v >> 1));
 
-    cpu.A = r;
-  } else {
-    const auto address = T(cpu);
-    const auto v = cpu.read(address);
-    const auto r = static_cast<uint8>((v << 1) | cpu.P.C);
+      cpu.P.C = v.bit(0);
+      cpu.P.Z = r == 0;
+      cpu.P.N = r.bit(7);
 
-    cpu.P.C = v.bit(7);
-    cpu.P.Z = r == 0;
-    cpu.P.N = r.bit(7);
+      cpu.write(address, r);
+    }
+  }
 
-    cpu.write(address, r);
+  static void op_rti(cpu_t &cpu) {
+    op_plp(cpu);
+    cpu.PC = cpu.pop16();
   }
-}
 
-template <addr_func_t T> static void op_ror(Cpu &cpu) {
-  cpu.tick();
+  static void op_rts(cpu_t &cpu) {
+    cpu.tick();
+    cpu.tick();
+    cpu.tick();
+    cpu.PC = cpu.pop16() + 1;
+  }
 
-  if (T == addr_acc) {
-    const auto v = cpu.A;
-    const auto r = static_cast<uint8>((cpu.P.C << 7) | (v >> 1));
+  template <addr_func_t T> static void op_sbc(cpu_t &cpu) {
+    const auto v = static_cast<uint8>(cpu.read(T(cpu)) ^ 0xff);
+    const uint16 r16 = cpu.A + v + cpu.P.C;
+    const auto r = static_cast<uint8>(r16);
 
-    cpu.P.C = v.bit(0);
+    cpu.P.C = r16.bit(8);
     cpu.P.Z = r == 0;
+    cpu.P.V = (~(cpu.A ^ v) & (cpu.A ^ r) & 0x80) != 0;
     cpu.P.N = r.bit(7);
 
     cpu.A = r;
-  } else {
-    const auto address = T(cpu);
-    const auto v = cpu.read(address);
-    const auto r = static_cast<uint8>((cpu.P.C << 7) | (v >> 1));
-
-    cpu.P.C = v.bit(0);
-    cpu.P.Z = r == 0;
-    cpu.P.N = r.bit(7);
-
-    cpu.write(address, r);
   }
-}
-
-static void op_rti(Cpu &cpu) {
-  op_plp(cpu);
-  cpu.PC = cpu.pop16();
-}
-
-static void op_rts(Cpu &cpu) {
-  cpu.tick();
-  cpu.tick();
-  cpu.tick();
-  cpu.PC = cpu.pop16() + 1;
-}
 
-template <addr_func_t T> static void op_sbc(Cpu &cpu) {
-  const auto v = static_cast<uint8>(cpu.read(T(cpu)) ^ 0xff);
-  const uint16 r16 = cpu.A + v + cpu.P.C;
-  const auto r = static_cast<uint8>(r16);
-
-  cpu.P.C = r16.bit(8);
-  cpu.P.Z = r == 0;
-  cpu.P.V = (~(cpu.A ^ v) & (cpu.A ^ r) & 0x80) != 0;
-  cpu.P.N = r.bit(7);
-
-  cpu.A = r;
-}
+  static void op_sec(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.C = true;
+  }
 
-static void op_sec(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.C = true;
-}
+  static void op_sed(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.D = true;
+  }
 
-static void op_sed(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.D = true;
-}
+  static void op_sei(cpu_t &cpu) {
+    cpu.tick();
+    cpu.P.I = true;
+  }
 
-static void op_sei(Cpu &cpu) {
-  cpu.tick();
-  cpu.P.I = true;
-}
+  template <addr_func_t T> static void op_sta(cpu_t &cpu) { cpu.write(T(cpu), cpu.A); }
 
-template <addr_func_t T> static void op_sta(Cpu &cpu) { cpu.write(T(cpu), cpu.A); }
+  template <addr_func_t T> static void op_stx(cpu_t &cpu) { cpu.write(T(cpu), cpu.X); }
 
-template <addr_func_t T> static void op_stx(Cpu &cpu) { cpu.write(T(cpu), cpu.X); }
+  template <addr_func_t T> static void op_sty(cpu_t &cpu) { cpu.write(T(cpu), cpu.Y); }
 
-template <addr_func_t T> static void op_sty(Cpu &cpu) { cpu.write(T(cpu), cpu.Y); }
+  static void op_tax(cpu_t &cpu) {
+    cpu.tick();
+    cpu.X = cpu.A;
 
-static void op_tax(Cpu &cpu) {
-  cpu.tick();
-  cpu.X = cpu.A;
+    cpu.P.Z = (cpu.X == 0);
+    cpu.P.N = cpu.X.bit(7);
+  }
 
-  cpu.P.Z = (cpu.X == 0);
-  cpu.P.N = cpu.X.bit(7);
-}
+  static void op_tay(cpu_t &cpu) {
+    cpu.tick();
+    cpu.Y = cpu.A;
 
-static void op_tay(Cpu &cpu) {
-  cpu.tick();
-  cpu.Y = cpu.A;
+    cpu.P.Z = (cpu.Y == 0);
+    cpu.P.N = cpu.Y.bit(7);
+  }
 
-  cpu.P.Z = (cpu.Y == 0);
-  cpu.P.N = cpu.Y.bit(7);
-}
+  static void op_tsx(cpu_t &cpu) {
+    cpu.tick();
+    cpu.X = cpu.S;
 
-static void op_tsx(Cpu &cpu) {
-  cpu.tick();
-  cpu.X = cpu.S;
+    cpu.P.Z = (cpu.X == 0);
+    cpu.P.N = cpu.X.bit(7);
+  }
 
-  cpu.P.Z = (cpu.X == 0);
-  cpu.P.N = cpu.X.bit(7);
-}
+  static void op_txa(cpu_t &cpu) {
+    cpu.tick();
+    cpu.A = cpu.X;
 
-static void op_txa(Cpu &cpu) {
-  cpu.tick();
-  cpu.A = cpu.X;
+    cpu.P.Z = (cpu.A == 0);
+    cpu.P.N = cpu.A.bit(7);
+  }
 
-  cpu.P.Z = (cpu.A == 0);
-  cpu.P.N = cpu.A.bit(7);
-}
+  static void op_txs(cpu_t &cpu) {
+    cpu.tick();
+    cpu.S = cpu.X;
+  }
 
-static void op_txs(Cpu &cpu) {
-  cpu.tick();
-  cpu.S = cpu.X;
-}
+  static void op_tya(cpu_t &cpu) {
+    cpu.tick();
+    cpu.A = cpu.Y;
 
-static void op_tya(Cpu &cpu) {
-  cpu.tick();
-  cpu.A = cpu.Y;
+    cpu.P.Z = (cpu.A == 0);
+    cpu.P.N = cpu.A.bit(7);
+  }
 
-  cpu.P.Z = (cpu.A == 0);
-  cpu.P.N = cpu.A.bit(7);
-}
+  static const std::array<instr_func_t, 256> table;
+};
 
-const std::array<instr_func_t, 256> instructions = {
+template <typename Bus>
+const std::array<typename Instructions<Bus>::instr_func_t, 256> Instructions<Bus>::table = {
     // 0x00
     op_brk, op_ora<addr_inx>, op_nop, op_nop, op_nop, op_ora<addr_zpg>, op_asl<addr_zpg>, op_nop,
     op_php, op_ora<addr_imm>, op_asl<addr_acc>, op_nop, op_nop, op_ora<addr_abs>, op_asl<addr_abs>,
@@ -1279,4 +774,10 @@ const std::array<instr_func_t, 256> instructions = {
 
 } // namespace
 
+// Explicit instantiations
+// * CpuCallbackBus is used when testing the CPU by itself
+// * Nesturbia::cpu_bus_t is used by the emulator so that its bus accesses can be inlined
+template struct Cpu<CpuCallbackBus>;
+template struct Cpu<Nesturbia::cpu_bus_t>;
+
 } // namespace nesturbia
@@ -7,6 +7,20 @@ void Joypad::SetInput(const input_t &input) {
                  input.down << 5 | input.left << 6 | input.right << 7;
 }
 
+Joypad::input_t Joypad::GetInput() const {
+  input_t input;
+  input.a = currentInput.bit(0);
+  input.b = currentInput.bit(1);
+  input.select = currentInput.bit(2);
+  input.start = currentInput.bit(3);
+  input.up = currentInput.bit(4);
+  input.down = currentInput.bit(5);
+  input.left = currentInput.bit(6);
+  input.right = currentInput.bit(7);
+
+  return input;
+}
+
 uint8 Joypad::Read() {
   // Initialize the return value
   // TODO I'm not yet sure why this bit is set
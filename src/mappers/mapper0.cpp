@@ -22,6 +22,17 @@ Mapper::ptr_t Mapper0::Create(const std::vector<uint8> &prgRom, const std::vecto
 
   mapper->mirrorType = mirrorType;
 
+  // 16K PRG-ROM is mirrored at $c000
+  const auto *prgRomData = mapper->prgRom.data();
+  const auto *prgRomHigh = prgRomData + (mapper->prgRom.size() - 0x4000);
+  mapper->prgBanks = {prgRomData, prgRomData + 0x2000, prgRomHigh, prgRomHigh + 0x2000};
+
+  if (mapper->chrRam.empty()) {
+    mapper->mapChr(0x0000, 0x2000, mapper->chrRom.data(), false);
+  } else {
+    mapper->mapChr(0x0000, 0x2000, mapper->chrRam.data(), true);
+  }
+
   return mapper;
 }
 
@@ -29,15 +40,7 @@ Mapper::mirror_t Mapper0::GetMirrorType() const { return mirrorType; }
 
 uint8 Mapper0::ReadPRG(uint16 address) {
   assert(address >= 0x8000);
-  address -= 0x8000;
-
-  // Mirror if using 16K PRG-ROM
-  // TODO this could be more efficient
-  if (prgRom.size() == 0x4000) {
-    address &= 0x3fff;
-  }
-
-  return prgRom[address];
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
 }
 
 void Mapper0::WritePRG(uint16 address, uint8) {
@@ -47,23 +50,11 @@ void Mapper0::WritePRG(uint16 address, uint8) {
   assert(0);
 }
 
-// TODO: can throw exception on out-of-bounds memory access due to .at()
-uint8 Mapper0::ReadCHR(uint16 address) {
-  if (!chrRom.empty()) {
-    return chrRom.at(address);
-  }
-
-  if (!chrRam.empty()) {
-    return chrRam.at(address);
-  }
-
-  assert(0);
-  return 0;
-}
+uint8 Mapper0::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
 
 void Mapper0::WriteCHR(uint16 address, uint8 value) {
-  if (address < chrRam.size()) {
-    chrRam[address] = value;
+  if (auto *bank = chrWriteBanks[(address >> 10) & 0x7]) {
+    bank[address & 0x3ff] = value;
     return;
   }
 
@@ -71,4 +62,8 @@ void Mapper0::WriteCHR(uint16 address, uint8 value) {
   assert(0);
 }
 
+void Mapper0::Serialize(Serializer &serializer) {
+  serializer.Bytes(chrRam.data(), chrRam.size());
+}
+
 } // namespace nesturbia
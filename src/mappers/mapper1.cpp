@@ -5,7 +5,11 @@
 namespace nesturbia {
 
 Mapper::ptr_t Mapper1::Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom) {
-  // TODO: Validate PRG-ROM size?
+  // Validate PRG-ROM size (must be a multiple of 16K)
+  if (prgRom.empty() || (prgRom.size() & 0x3fff) != 0) {
+    return nullptr;
+  }
+
   auto mapper = std::make_unique<Mapper1>();
 
   mapper->prgRom = prgRom;
@@ -15,6 +19,9 @@ Mapper::ptr_t Mapper1::Create(const std::vector<uint8> &prgRom, const std::vecto
     mapper->chrRam.resize(0x2000);
   }
 
+  mapper->updatePrgBanks();
+  mapper->updateChrBanks();
+
   return mapper;
 }
 
@@ -28,44 +35,7 @@ Mapper::mirror_t Mapper1::GetMirrorType() const {
 
 uint8 Mapper1::ReadPRG(uint16 address) {
   assert(address >= 0x8000);
-
-  uint8 page16KLow;
-  uint8 page16KHigh;
-
-  switch (controlRegister.prgRomBankMode) {
-  case 0x0:
-  case 0x1:
-    // 32 KB mode
-    // Bit 0 is the 16 KB offset, so ignore it to get the 32 KB page on which it resides
-    page16KLow = prgBankRegister.prgRomBank & 0xe;
-    page16KHigh = page16KLow | 0x1;
-    break;
-
-  case 0x2:
-    // Fix the first bank at $8000
-    page16KLow = 0;
-
-    // Switch 16 KB bank at $c000
-    page16KHigh = prgBankRegister.prgRomBank;
-    break;
-
-  case 0x3:
-    // Switch 16 KB bank at $8000
-    page16KLow = prgBankRegister.prgRomBank;
-
-    // Fix the last bank at $c000
-    page16KHigh = (prgRom.size() >> 14) - 1;
-    break;
-  }
-
-  // TODO: using .at() for now to detect out of bounds memory access
-  if (address < 0xc000) {
-    // "Low" address
-    return prgRom.at((page16KLow << 14) | (address & 0x3fff));
-  }
-
-  // "High" address
-  return prgRom.at((page16KHigh << 14) | (address & 0x3fff));
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
 }
 
 void Mapper1::WritePRG(uint16 address, uint8 value) {
@@ -127,40 +97,94 @@ void Mapper1::WritePRG(uint16 address, uint8 value) {
 
     // Clear the shift register to its reset state after the 5th write
     shiftRegister = 0x10;
+
+    updatePrgBanks();
+    updateChrBanks();
   }
 }
 
-uint8 Mapper1::ReadCHR(uint16 address) {
-  // TODO: make more efficient
-  if (!chrRam.empty()) {
-    // TODO: using .at() to detect out of bounds memory accesses
-    return chrRam.at(address);
-  }
+uint8 Mapper1::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
 
-  if (address < chrRom.size()) {
-    return chrRom[address];
+void Mapper1::WriteCHR(uint16 address, uint8 value) {
+  // Writes to CHR-ROM are ignored
+  if (auto *bank = chrWriteBanks[(address >> 10) & 0x7]) {
+    bank[address & 0x3ff] = value;
   }
+}
+
+void Mapper1::Serialize(Serializer &serializer) {
+  serializer.Bytes(chrRam.data(), chrRam.size());
+
+  serializer(shiftRegister);
+  serializer(controlRegister);
+  serializer(chrBankRegisters);
+  serializer(prgBankRegister);
 
-  // TODO: testing
-  assert(0);
-  return 0;
+  if (serializer.IsLoading()) {
+    updatePrgBanks();
+    updateChrBanks();
+  }
 }
 
-void Mapper1::WriteCHR(uint16 address, uint8 value) {
-  // TODO: make more efficient
-  if (!chrRam.empty()) {
-    // TODO: using .at() to detect out of bounds memory accesses
-    chrRam.at(address) = value;
-    return;
+void Mapper1::updatePrgBanks() {
+  const auto num16KPages = prgRom.size() >> 14;
+
+  uint8 page16KLow;
+  uint8 page16KHigh;
+
+  switch (controlRegister.prgRomBankMode) {
+  case 0x0:
+  case 0x1:
+    // 32 KB mode
+    // Bit 0 is the 16 KB offset, so ignore it to get the 32 KB page on which it resides
+    page16KLow = prgBankRegister.prgRomBank & 0xe;
+    page16KHigh = page16KLow | 0x1;
+    break;
+
+  case 0x2:
+    // Fix the first bank at $8000
+    page16KLow = 0;
+
+    // Switch 16 KB bank at $c000
+    page16KHigh = prgBankRegister.prgRomBank;
+    break;
+
+  case 0x3:
+    // Switch 16 KB bank at $8000
+    page16KLow = prgBankRegister.prgRomBank;
+
+    // Fix the last bank at $c000
+    page16KHigh = num16KPages - 1;
+    break;
   }
 
-  if (address < chrRom.size()) {
-    chrRom[address] = value;
-    return;
+  // Banks past the end of PRG-ROM wrap around
+  const auto *low = &prgRom[(page16KLow % num16KPages) << 14];
+  const auto *high = &prgRom[(page16KHigh % num16KPages) << 14];
+  prgBanks = {low, low + 0x2000, high, high + 0x2000};
+}
+
+void Mapper1::updateChrBanks() {
+  const bool isRam = !chrRam.empty();
+  auto &chr = isRam ? chrRam : chrRom;
+  const auto num4KPages = chr.size() >> 12;
+
+  uint8 page4KLow;
+  uint8 page4KHigh;
+
+  if (controlRegister.chrRomBankMode) {
+    // Two separate 4 KB banks
+    page4KLow = chrBankRegisters[0];
+    page4KHigh = chrBankRegisters[1];
+  } else {
+    // 8 KB mode
+    page4KLow = chrBankRegisters[0] & 0x1e;
+    page4KHigh = page4KLow | 0x1;
   }
 
-  // TODO: testing
-  assert(0);
+  // Banks past the end of CHR-ROM/RAM wrap around
+  mapChr(0x0000, 0x1000, &chr[(page4KLow % num4KPages) << 12], isRam);
+  mapChr(0x1000, 0x1000, &chr[(page4KHigh % num4KPages) << 12], isRam);
 }
 
 } // namespace nesturbia
@@ -0,0 +1,77 @@
+#include <cassert>
+
+#include "nesturbia/mappers/mapper2.hpp"
+
+namespace nesturbia {
+
+Mapper::ptr_t Mapper2::Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom,
+                              mirror_t mirrorType) {
+  // Validate PRG-ROM size (must be a multiple of 16K)
+  if (prgRom.empty() || (prgRom.size() & 0x3fff) != 0) {
+    return nullptr;
+  }
+
+  auto mapper = std::make_unique<Mapper2>();
+
+  mapper->prgRom = prgRom;
+  mapper->chrRom = chrRom;
+  mapper->mirrorType = mirrorType;
+
+  if (mapper->chrRom.empty()) {
+    // Empty CHR-ROM means that we get 8K CHR-RAM
+    mapper->chrRam.resize(0x2000);
+    mapper->mapChr(0x0000, 0x2000, mapper->chrRam.data(), true);
+  } else {
+    mapper->mapChr(0x0000, 0x2000, mapper->chrRom.data(), false);
+  }
+
+  // The last 16K bank is fixed at $c000
+  mapper->mapPrg(0xc000, 0x4000, &mapper->prgRom[mapper->prgRom.size() - 0x4000]);
+  mapper->updatePrgBanks();
+
+  return mapper;
+}
+
+Mapper::mirror_t Mapper2::GetMirrorType() const { return mirrorType; }
+
+uint8 Mapper2::ReadPRG(uint16 address) {
+  assert(address >= 0x8000);
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
+}
+
+void Mapper2::WritePRG(uint16 address, uint8 value) {
+  (void)address;
+  assert(address >= 0x8000);
+
+  // PRG-ROM bank select
+  // UNROM uses 3 bits and UOROM 4, but the whole value is kept so that larger ROMs work as well
+  prgBank = value;
+
+  updatePrgBanks();
+}
+
+uint8 Mapper2::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
+
+void Mapper2::WriteCHR(uint16 address, uint8 value) {
+  // Writes to CHR-ROM are ignored
+  if (auto *bank = chrWriteBanks[(address >> 10) & 0x7]) {
+    bank[address & 0x3ff] = value;
+  }
+}
+
+void Mapper2::Serialize(Serializer &serializer) {
+  serializer.Bytes(chrRam.data(), chrRam.size());
+  serializer(prgBank);
+
+  if (serializer.IsLoading()) {
+    updatePrgBanks();
+  }
+}
+
+void Mapper2::updatePrgBanks() {
+  // Banks past the end of PRG-ROM wrap around
+  const auto num16KPages = prgRom.size() >> 14;
+  mapPrg(0x8000, 0x4000, &prgRom[(prgBank % num16KPages) << 14]);
+}
+
+} // namespace nesturbia
@@ -11,12 +11,24 @@ Mapper::ptr_t Mapper3::Create(const std::vector<uint8> &prgRom, const std::vecto
     return nullptr;
   }
 
+  // CNROM always has CHR-ROM, since switching CHR banks is all that it does
+  if (chrRom.empty()) {
+    return nullptr;
+  }
+
   auto mapper = std::make_unique<Mapper3>();
 
   mapper->prgRom = prgRom;
   mapper->chrRom = chrRom;
   mapper->mirrorType = mirrorType;
 
+  // 16K PRG-ROM is mirrored at $c000
+  const auto *prgRomData = mapper->prgRom.data();
+  const auto *prgRomHigh = prgRomData + (mapper->prgRom.size() - 0x4000);
+  mapper->prgBanks = {prgRomData, prgRomData + 0x2000, prgRomHigh, prgRomHigh + 0x2000};
+
+  mapper->updateChrBanks();
+
   return mapper;
 }
 
@@ -24,11 +36,7 @@ Mapper::mirror_t Mapper3::GetMirrorType() const { return mirrorType; }
 
 uint8 Mapper3::ReadPRG(uint16 address) {
   assert(address >= 0x8000);
-  address -= 0x8000;
-
-  // TODO: mirroring?
-
-  return prgRom.at(address);
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
 }
 
 void Mapper3::WritePRG(uint16 address, uint8 value) {
@@ -38,10 +46,11 @@ void Mapper3::WritePRG(uint16 address, uint8 value) {
   // CHR bank select
   // TODO: nesdev mentions 'oversize' CHR up to 2MB (8 bits), but 32K (2 bits) is common
   chrBank = value & 0x3;
+
+  updateChrBanks();
 }
 
-// TODO: can throw exception on out-of-bounds memory access due to .at()
-uint8 Mapper3::ReadCHR(uint16 address) { return chrRom.at((chrBank << 13) | (address & 0x1fff)); }
+uint8 Mapper3::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
 
 void Mapper3::WriteCHR(uint16 address, uint8 value) {
   (void)address;
@@ -51,4 +60,18 @@ void Mapper3::WriteCHR(uint16 address, uint8 value) {
   // assert(0);
 }
 
+void Mapper3::Serialize(Serializer &serializer) {
+  serializer(chrBank);
+
+  if (serializer.IsLoading()) {
+    updateChrBanks();
+  }
+}
+
+void Mapper3::updateChrBanks() {
+  // Banks past the end of CHR-ROM wrap around
+  const auto num8KBanks = chrRom.size() >> 13;
+  mapChr(0x0000, 0x2000, &chrRom[(chrBank % num8KBanks) << 13], false);
+}
+
 } // namespace nesturbia
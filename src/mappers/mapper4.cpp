@@ -1,21 +1,33 @@
 #include <cassert>
+#include <utility>
 
 #include "nesturbia/mappers/mapper4.hpp"
 
 namespace nesturbia {
 
-// TODO: this does nothing useful for now; nes-test-roms/stomper/smwstomp.nes uses this mapper
 Mapper::ptr_t Mapper4::Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom,
                               mirror_t mirrorType) {
-  // TODO: Validate PRG-ROM size?
+  // Validate PRG-ROM size (must be a multiple of 16K)
+  if (prgRom.empty() || (prgRom.size() & 0x3fff) != 0) {
+    return nullptr;
+  }
 
   auto mapper = std::make_unique<Mapper4>();
 
-  // TODO: implement
-  (void)prgRom;
-  (void)chrRom;
+  mapper->prgRom = prgRom;
+  mapper->chrRom = chrRom;
+
+  if (chrRom.empty()) {
+    // Empty CHR-ROM means that we get 8K CHR-RAM (e.g., TNROM)
+    mapper->chrRam.resize(0x2000);
+  }
 
+  // The mirroring register takes over once it's written
   mapper->mirrorType = mirrorType;
+  mapper->countsScanlines = true;
+
+  mapper->updatePrgBanks();
+  mapper->updateChrBanks();
 
   return mapper;
 }
@@ -24,68 +36,156 @@ Mapper::mirror_t Mapper4::GetMirrorType() const { return mirrorType; }
 
 uint8 Mapper4::ReadPRG(uint16 address) {
   assert(address >= 0x8000);
-  address -= 0x8000;
-
-  // TODO temporary assert
-  assert(0);
-  return 0;
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
 }
 
-void Mapper4::WritePRG(uint16 address, uint8) {
+void Mapper4::WritePRG(uint16 address, uint8 value) {
   assert(address >= 0x8000);
 
   if (address < 0xa000) {
     if (address.bit(0)) {
       // Odd: bank data
-      // TODO
+      bankRegisters[bankSelectRegister.bankRegister] = value;
     } else {
       // Even: bank select
-      // TODO
+      bankSelectRegister.bankRegister = value & 0x7;
+      bankSelectRegister.prgRomBankMode = value.bit(6);
+      bankSelectRegister.chrA12Inversion = value.bit(7);
     }
+
+    updatePrgBanks();
+    updateChrBanks();
   } else if (address < 0xc000) {
     if (address.bit(0)) {
       // Odd: PRG-RAM protect
-      // TODO
+      prgRamProtectRegister.denyWrites = value.bit(6);
+      prgRamProtectRegister.chipEnable = value.bit(7);
+      updatePrgBanks();
     } else {
       // Even: mirroring
-      // TODO
+      mirrorType = value.bit(0) ? mirror_t::horizontal : mirror_t::vertical;
     }
   } else if (address < 0xe000) {
     if (address.bit(0)) {
-      // Odd: IRQ reload
-      // TODO
+      // Odd: IRQ reload (the counter is reloaded on the next clock)
+      irqCounter = 0;
+      irqReload = true;
     } else {
       // Even: IRQ latch
-      // TODO
+      irqLatch = value;
     }
   } else {
     // Addresses between $0xe000-$ffff
-    if (address.bit(0)) {
-      // Odd: IRQ enable
-      // TODO
-    } else {
-      // Even: IRQ disable
-      // TODO
+    // Even: IRQ disable, which also acknowledges a pending IRQ
+    // Odd: IRQ enable
+    irqEnabled = address.bit(0);
+    if (!irqEnabled) {
+      isIrqAsserted = false;
     }
   }
+}
+
+uint8 Mapper4::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
 
-  // TODO temporary assert
-  assert(0);
+void Mapper4::WriteCHR(uint16 address, uint8 value) {
+  // Writes to CHR-ROM are ignored
+  if (auto *bank = chrWriteBanks[(address >> 10) & 0x7]) {
+    bank[address & 0x3ff] = value;
+  }
 }
 
-// TODO: can throw exception on out-of-bounds memory access due to .at()
-uint8 Mapper4::ReadCHR(uint16 address) {
-  (void)address; // TODO remove me
-  // TODO temporary assert
-  assert(0);
-  return 0;
+bool Mapper4::ClockScanline() {
+  if (irqCounter == 0 || irqReload) {
+    irqCounter = irqLatch;
+    irqReload = false;
+  } else {
+    --irqCounter;
+  }
+
+  if (irqCounter == 0 && irqEnabled) {
+    isIrqAsserted = true;
+    return true;
+  }
+
+  return false;
 }
 
-void Mapper4::WriteCHR(uint16 address, uint8 value) {
-  (void)address;
-  (void)value; // TODO remove me
-  // TODO: temporary assert
-  assert(0);
+uint32_t Mapper4::ScanlinesUntilIrq() const {
+  if (!irqEnabled) {
+    return 0;
+  }
+
+  if (irqCounter == 0 || irqReload) {
+    // The first clock reloads the counter, and then it counts down from the latch (with a latch of
+    // zero, every clock raises an IRQ)
+    return irqLatch == 0 ? 1U : 1U + irqLatch;
+  }
+
+  return irqCounter;
+}
+
+void Mapper4::Serialize(Serializer &serializer) {
+  serializer.Bytes(chrRam.data(), chrRam.size());
+
+  serializer(bankSelectRegister);
+  serializer(bankRegisters);
+  serializer(mirrorType);
+  serializer(prgRamProtectRegister);
+
+  serializer(irqLatch);
+  serializer(irqCounter);
+  serializer(irqReload);
+  serializer(irqEnabled);
+  serializer(isIrqAsserted);
+
+  if (serializer.IsLoading()) {
+    updatePrgBanks();
+    updateChrBanks();
+  }
+}
+
+void Mapper4::updatePrgBanks() {
+  const auto num8KPages = prgRom.size() >> 13;
+
+  // $c000 (or $8000 in PRG-ROM bank mode 1) is fixed to the second to last bank, and $e000 to the
+  // last one
+  std::array<size_t, 4> pages8K = {bankRegisters[6], bankRegisters[7], num8KPages - 2,
+                                   num8KPages - 1};
+  if (bankSelectRegister.prgRomBankMode) {
+    std::swap(pages8K[0], pages8K[2]);
+  }
+
+  // Banks past the end of PRG-ROM wrap around
+  for (size_t i = 0; i < pages8K.size(); i++) {
+    prgBanks[i] = &prgRom[(pages8K[i] % num8KPages) << 13];
+  }
+
+  isWorkRamEnabled = prgRamProtectRegister.chipEnable;
+  isWorkRamWritable = prgRamProtectRegister.chipEnable && !prgRamProtectRegister.denyWrites;
+}
+
+void Mapper4::updateChrBanks() {
+  const bool isRam = !chrRam.empty();
+  auto &chr = isRam ? chrRam : chrRom;
+  const auto num1KPages = chr.size() >> 10;
+
+  // The 2K banks' bottom bits are ignored
+  const std::array<uint8_t, 8> pages1K = {
+      static_cast<uint8_t>(bankRegisters[0] & 0xfe), static_cast<uint8_t>(bankRegisters[0] | 0x1),
+      static_cast<uint8_t>(bankRegisters[1] & 0xfe), static_cast<uint8_t>(bankRegisters[1] | 0x1),
+      bankRegisters[2],
+      bankRegisters[3],
+      bankRegisters[4],
+      bankRegisters[5],
+  };
+
+  // With CHR A12 inversion, the 2K banks are at $1000-$1fff instead
+  const uint16_t inversion = bankSelectRegister.chrA12Inversion ? 0x1000 : 0x0000;
+
+  // Banks past the end of CHR-ROM/RAM wrap around
+  for (uint16_t i = 0; i < pages1K.size(); i++) {
+    mapChr((i << 10) ^ inversion, 0x400, &chr[(pages1K[i] % num1KPages) << 10], isRam);
+  }
 }
 
 } // namespace nesturbia
@@ -0,0 +1,76 @@
+#include <cassert>
+
+#include "nesturbia/mappers/mapper66.hpp"
+
+namespace nesturbia {
+
+Mapper::ptr_t Mapper66::Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom,
+                               mirror_t mirrorType) {
+  // Validate PRG-ROM size (must be a multiple of 32K)
+  if (prgRom.empty() || (prgRom.size() & 0x7fff) != 0) {
+    return nullptr;
+  }
+
+  auto mapper = std::make_unique<Mapper66>();
+
+  mapper->prgRom = prgRom;
+  mapper->chrRom = chrRom;
+  if (mapper->chrRom.empty()) {
+    // Empty CHR-ROM means that we get 8K CHR-RAM
+    mapper->chrRam.resize(0x2000);
+  }
+
+  mapper->mirrorType = mirrorType;
+
+  mapper->updateBanks();
+
+  return mapper;
+}
+
+Mapper::mirror_t Mapper66::GetMirrorType() const { return mirrorType; }
+
+uint8 Mapper66::ReadPRG(uint16 address) {
+  assert(address >= 0x8000);
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
+}
+
+void Mapper66::WritePRG(uint16 address, uint8 value) {
+  (void)address;
+  assert(address >= 0x8000);
+
+  bankRegister.prgRomBank = (value >> 4) & 0x3;
+  bankRegister.chrBank = value & 0x3;
+
+  updateBanks();
+}
+
+uint8 Mapper66::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
+
+void Mapper66::WriteCHR(uint16 address, uint8 value) {
+  // Writes to CHR-ROM are ignored
+  if (auto *bank = chrWriteBanks[(address >> 10) & 0x7]) {
+    bank[address & 0x3ff] = value;
+  }
+}
+
+void Mapper66::Serialize(Serializer &serializer) {
+  serializer.Bytes(chrRam.data(), chrRam.size());
+  serializer(bankRegister);
+
+  if (serializer.IsLoading()) {
+    updateBanks();
+  }
+}
+
+void Mapper66::updateBanks() {
+  const bool isRam = !chrRam.empty();
+  auto &chr = isRam ? chrRam : chrRom;
+
+  // Banks past the end of PRG-ROM and CHR-ROM/RAM wrap around
+  const auto num32KPages = prgRom.size() >> 15;
+  const auto num8KPages = chr.size() >> 13;
+  mapPrg(0x8000, 0x8000, &prgRom[(bankRegister.prgRomBank % num32KPages) << 15]);
+  mapChr(0x0000, 0x2000, &chr[(bankRegister.chrBank % num8KPages) << 13], isRam);
+}
+
+} // namespace nesturbia
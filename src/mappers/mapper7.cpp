@@ -0,0 +1,74 @@
+#include <cassert>
+
+#include "nesturbia/mappers/mapper7.hpp"
+
+namespace nesturbia {
+
+Mapper::ptr_t Mapper7::Create(const std::vector<uint8> &prgRom, const std::vector<uint8> &chrRom) {
+  // Validate PRG-ROM size (must be a multiple of 32K)
+  if (prgRom.empty() || (prgRom.size() & 0x7fff) != 0) {
+    return nullptr;
+  }
+
+  auto mapper = std::make_unique<Mapper7>();
+
+  mapper->prgRom = prgRom;
+  mapper->chrRom = chrRom;
+
+  if (mapper->chrRom.empty()) {
+    // Empty CHR-ROM means that we get 8K CHR-RAM
+    mapper->chrRam.resize(0x2000);
+    mapper->mapChr(0x0000, 0x2000, mapper->chrRam.data(), true);
+  } else {
+    mapper->mapChr(0x0000, 0x2000, mapper->chrRom.data(), false);
+  }
+
+  mapper->updatePrgBanks();
+
+  return mapper;
+}
+
+Mapper::mirror_t Mapper7::GetMirrorType() const {
+  return bankRegister.nametable ? mirror_t::oneScreenHigher : mirror_t::oneScreenLower;
+}
+
+uint8 Mapper7::ReadPRG(uint16 address) {
+  assert(address >= 0x8000);
+  return prgBanks[(address >> 13) & 0x3][address & 0x1fff];
+}
+
+void Mapper7::WritePRG(uint16 address, uint8 value) {
+  (void)address;
+  assert(address >= 0x8000);
+
+  bankRegister.prgRomBank = value & 0x7;
+  bankRegister.nametable = value.bit(4);
+
+  updatePrgBanks();
+}
+
+uint8 Mapper7::ReadCHR(uint16 address) { return chrBanks[(address >> 10) & 0x7][address & 0x3ff]; }
+
+void Mapper7::WriteCHR(uint16 address, uint8 value) {
+  // Writes to CHR-ROM are ignored
+  if (auto *bank = chrWriteBanks[(address >> 10) & 0x7]) {
+    bank[address & 0x3ff] = value;
+  }
+}
+
+void Mapper7::Serialize(Serializer &serializer) {
+  serializer.Bytes(chrRam.data(), chrRam.size());
+  serializer(bankRegister);
+
+  if (serializer.IsLoading()) {
+    updatePrgBanks();
+  }
+}
+
+void Mapper7::updatePrgBanks() {
+  // Banks past the end of PRG-ROM wrap around
+  const auto num32KPages = prgRom.size() >> 15;
+  mapPrg(0x8000, 0x8000, &prgRom[(bankRegister.prgRomBank % num32KPages) << 15]);
+}
+
+} // namespace nesturbia
@@ -1,27 +1,49 @@
-#include <cassert>
-
 #include "nesturbia/nesturbia.hpp"
 
 namespace nesturbia {
 
 Nesturbia::Nesturbia()
-    : cpu([this](uint16 address) { return cpuReadCallback(address); },
-          [this](uint16 address, uint8 value) { cpuWriteCallback(address, value); },
-          [this] { cpuTickCallback(); }),
-      ppu(cartridge, [this] { cpu.NMI(); }) {}
+    : cpu(cpu_bus_t{*this}),
+      ppu(cartridge, [this] { cpu.NMI(); }, [this] { cpu.IRQ(cpu_t::irq_source_t::cartridge); }) {
+  // RAM ($0000-$07ff, but mirrored up to $1fff)
+  for (size_t page = 0x00; page < 0x20; page++) {
+    cpuReadPages[page] = cpuWritePages[page] = &ram[(page & 0x7) << 8];
+  }
+
+  // Work RAM ($6000-$7fff)
+  for (size_t page = 0x60; page < 0x80; page++) {
+    cpuReadPages[page] = cpuWritePages[page] = &cartridge.workRam[(page - 0x60) << 8];
+  }
+}
 
-void Nesturbia::SetAudioSampleCallback(Cpu::sample_callback_t sampleCallback, uint32_t sampleRate) {
-  cpu.SetSampleCallback(sampleCallback, sampleRate);
+void Nesturbia::SetAudioOutput(const AudioOutput &audioOutput, uint32_t sampleRate) {
+  cpu.apu.SetAudioOutput(audioOutput, sampleRate);
 }
 
+void Nesturbia::SetAudioSampleRate(double sampleRate) { cpu.apu.SetSampleRate(sampleRate); }
+
 bool Nesturbia::LoadRom(const void *romData, size_t romDataSize) {
   if (!cartridge.LoadRom(romData, romDataSize)) {
     return false;
   }
 
+  updatePrgPages();
+
   cpu.Power();
   ppu.Power();
 
+  // Any PPU ticks from before the PPU was powered are discarded
+  ppuPendingDots = 0;
+  schedulePpu();
+
+  // The history of the previous ROM is of no use
+  if (rewindBufferSize != 0) {
+    EnableRewind(rewindBufferSize);
+  }
+
+  // The size of the state may have changed
+  SetRunAhead(runAheadFrames);
+
   return true;
 }
 
@@ -29,7 +51,35 @@ bool Nesturbia::LoadBatteryBackedRam(const void *ramData, size_t ramDataSize) {
   return cartridge.LoadBatteryBackedRAM(ramData, ramDataSize);
 }
 
-void Nesturbia::RunFrame(const Joypad::input_t &joypadInput1, const Joypad::input_t &joypadInput2) {
+void Nesturbia::RunFrame(const Joypad::input_t &joypadInput1, const Joypad::input_t &joypadInput2,
+                         const FrameOutput &output) {
+  cpu.apu.isOutputEnabled = output.audio;
+
+  if (runAheadFrames != 0 && cartridge.mapper) {
+    // Only the audio of the real frame is output, and only the video of the last frame ahead
+    ppu.isOutputEnabled = false;
+    runFrame(joypadInput1, joypadInput2);
+
+    SaveState(runAheadState.data(), runAheadState.size());
+
+    cpu.apu.isOutputEnabled = false;
+    for (uint32_t frame = 1; frame <= runAheadFrames; frame++) {
+      ppu.isOutputEnabled = output.video && frame == runAheadFrames;
+      runFrame(joypadInput1, joypadInput2);
+    }
+
+    LoadState(runAheadState.data(), runAheadState.size());
+  } else {
+    ppu.isOutputEnabled = output.video;
+    runFrame(joypadInput1, joypadInput2);
+  }
+
+  if (rewindBufferSize != 0 && SaveState(rewindState.data(), rewindState.size())) {
+    rewindBuffer.Push(rewindState.data());
+  }
+}
+
+void Nesturbia::runFrame(const Joypad::input_t &joypadInput1, const Joypad::input_t &joypadInput2) {
   // Update joypad inputs
   joypads[0].SetInput(joypadInput1);
   joypads[1].SetInput(joypadInput2);
@@ -41,68 +91,181 @@ void Nesturbia::RunFrame(const Joypad::input_t &joypadInput1, const Joypad::inpu
       break;
     }
   }
+
+  // Catch the PPU up to the end of the last instruction
+  syncPpu();
+
+  // Hand over the frame's audio
+  cpu.apu.FlushAudio();
 }
 
-uint8 Nesturbia::cpuReadCallback(uint16 address) {
-  // TODO read from joypad 1 (zero-indexed, the second one)
-  if (address < 0x2000) {
-    // RAM (0x0000 - 0x07ff, but mirrored up to 0x1fff)
-    return ram[address & 0x7ff];
-  } else if (address < 0x4000) {
-    // PPU registers (and their mirrors)
-    return ppu.ReadRegister(address);
-  } else if (address < 0x4016) {
-    // APU register (handled internally)
-    assert(0);
-    return 0;
-  } else if (address == 0x4016) {
-    return joypads[0].Read();
-  } else if (address == 0x4017) {
-    // TODO: handle 2nd joystick
-    return 0;
-  } else if (address < 0x4020) {
-    // APU register (handled internally)
-    assert(0);
-    return 0;
-  } else {
-    return cartridge.ReadPRG(address);
-  }
-}
-
-void Nesturbia::cpuWriteCallback(uint16 address, uint8 value) {
-  if (address < 0x2000) {
-    // RAM (0x0000 - 0x07ff, but mirrored up to 0x1fff)
-    ram[address & 0x7ff] = value;
-  } else if (address < 0x4000) {
-    // PPU registers (and their mirrors)
-    ppu.WriteRegister(address, value);
-  } else if (address < 0x4014) {
-    // APU registers (handled internally)
-    assert(0);
-  } else if (address == 0x4014) {
-    for (int i = 0; i < 256; i++) {
-      ppu.WriteRegister(0x2004, cpuReadCallback(value * 0x100 + i));
+size_t Nesturbia::StateSize() {
+  auto serializer = Serializer::Measure();
+  serialize(serializer);
+
+  return serializer.offset;
+}
+
+bool Nesturbia::SaveState(void *data, size_t dataSize) {
+  if (!cartridge.mapper) {
+    return false;
+  }
+
+  // Everything that the CPU did must be visible in the PPU's state
+  syncPpu();
+
+  auto serializer = Serializer::Save(data, dataSize);
+  serialize(serializer);
+
+  return serializer.isValid;
+}
+
+bool Nesturbia::LoadState(const void *data, size_t dataSize) {
+  // Check the size first, so that the state is either loaded completely or not at all
+  if (!cartridge.mapper || dataSize != StateSize()) {
+    return false;
+  }
+
+  auto serializer = Serializer::Load(data, dataSize);
+  serialize(serializer);
+  if (!serializer.isValid) {
+    return false;
+  }
+
+  updatePrgPages();
+  ppu.UpdateNametables();
+  ppu.UpdateChrPages();
+
+  return true;
+}
+
+void Nesturbia::EnableRewind(size_t bufferSize) {
+  rewindBufferSize = bufferSize;
+
+  // The size of the state depends on the ROM's mapper, so this is done again when loading a ROM
+  rewindState.assign(bufferSize != 0 ? StateSize() : 0, 0);
+  rewindBuffer.Reset(bufferSize, rewindState.size());
+
+  // Start from the current state, so that the first frame can be rewound to as well
+  if (bufferSize != 0 && SaveState(rewindState.data(), rewindState.size())) {
+    rewindBuffer.Push(rewindState.data());
+  }
+}
+
+bool Nesturbia::RewindFrame() {
+  // The two frames before the current one are needed: the one to go back to, and the one before
+  // that to run it from
+  if (rewindBuffer.NumStates() < 2) {
+    return false;
+  }
+
+  // The state after the previous frame holds that frame's input
+  rewindBuffer.Pop(rewindState.data());
+  LoadState(rewindState.data(), rewindState.size());
+
+  const auto joypadInput1 = joypads[0].GetInput();
+  const auto joypadInput2 = joypads[1].GetInput();
+
+  rewindBuffer.Pop(rewindState.data());
+  LoadState(rewindState.data(), rewindState.size());
+
+  // This captures the state after the previous frame again
+  RunFrame(joypadInput1, joypadInput2);
+
+  return true;
+}
+
+void Nesturbia::SetRunAhead(uint32_t frames) {
+  runAheadFrames = frames;
+
+  // The size of the state depends on the ROM's mapper, so this is done again when loading a ROM
+  runAheadState.assign(frames != 0 && cartridge.mapper ? StateSize() : 0, 0);
+}
+
+void Nesturbia::serialize(Serializer &serializer) {
+  // Header
+  constexpr uint32_t kMagic = 0x5453544e; // "NTST"
+
+  auto magic = kMagic;
+  auto version = kStateVersion;
+  auto crc32Hash = cartridge.crc32Hash;
+
+  serializer(magic);
+  serializer(version);
+  serializer(crc32Hash);
+
+  if (serializer.IsLoading() &&
+      (magic != kMagic || version != kStateVersion || crc32Hash != cartridge.crc32Hash)) {
+    serializer.isValid = false;
+    return;
+  }
+
+  cpu.Serialize(serializer);
+  ppu.Serialize(serializer);
+  cartridge.Serialize(serializer);
+
+  serializer(joypads);
+  serializer(ram);
+  serializer(ppuPendingDots);
+  serializer(ppuDotsUntilEvent);
+}
+
+void Nesturbia::oamDma(uint8 page) {
+  // Plain memory is copied straight from its page; anything else is read byte by byte
+  const auto *data = cpuReadPages[page];
+
+  std::array<uint8, 0x100> buffer;
+  if (!data) {
+    for (size_t i = 0; i < buffer.size(); i++) {
+      buffer[i] = cpuReadCallback(static_cast<uint16>(page * 0x100 + i));
     }
-  } else if (address == 0x4015) {
-    // APU register (handled internally)
-    assert(0);
-  } else if (address == 0x4016) {
-    // Joypad strobes
-    joypads[0].Strobe(value.bit(0));
-    joypads[1].Strobe(value.bit(0));
-  } else if (address < 0x4020) {
-    // APU register (handled internally)
-    assert(0);
-  } else {
-    cartridge.WritePRG(address, value);
+
+    data = buffer.data();
+  }
+
+  syncPpu();
+  ppu.WriteOamDma(data);
+
+  // The CPU is halted while the DMA runs: one cycle to halt (plus another one to line up with a
+  // read cycle, if it was halted on an odd one), then a read and a write for each byte
+  // The PPU is only caught up at its next event as usual, so this mostly just runs the APU
+  const uint32_t numStallCycles = 1 + (cpu.cycles & 1) + 2 * 0x100;
+  for (uint32_t i = 0; i < numStallCycles; i++) {
+    cpu.tick();
   }
 }
 
-void Nesturbia::cpuTickCallback() {
-  // Each CPU tick results in 3 PPU ticks
-  isNewFrame = isNewFrame || ppu.Tick();
-  isNewFrame = isNewFrame || ppu.Tick();
-  isNewFrame = isNewFrame || ppu.Tick();
+void Nesturbia::updatePrgPages() {
+  if (!cartridge.mapper) {
+    return;
+  }
+
+  // Work RAM ($6000-$7fff), which goes through the cartridge while the mapper disables or
+  // write-protects it
+  const auto &mapper = *cartridge.mapper;
+  for (size_t page = 0x60; page < 0x80; page++) {
+    auto *workRam = &cartridge.workRam[(page - 0x60) << 8];
+    cpuReadPages[page] = mapper.isWorkRamEnabled ? workRam : nullptr;
+    cpuWritePages[page] = mapper.isWorkRamWritable ? workRam : nullptr;
+  }
+
+  // PRG-ROM ($8000-$ffff)
+  for (size_t page = 0x80; page < 0x100; page++) {
+    const auto *bank = mapper.prgBanks[(page >> 5) & 0x3];
+    cpuReadPages[page] = bank ? bank + ((page & 0x1f) << 8) : nullptr;
+  }
 }
 
+void Nesturbia::syncPpu() {
+  if (ppu.Run(ppuPendingDots)) {
+    isNewFrame = true;
+  }
+
+  ppuPendingDots = 0;
+
+  schedulePpu();
+}
+
+void Nesturbia::schedulePpu() { ppuDotsUntilEvent = ppu.DotsUntilNextEvent(); }
+
 } // namespace nesturbia
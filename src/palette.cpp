@@ -0,0 +1,252 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "nesturbia/palette.hpp"
+
+// SSE2 is part of x86-64, so it can be used whenever the compiler targets it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NESTURBIA_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 isn't, so GCC and Clang compile the AVX2 code regardless of the build flags, and it's only
+// used if the CPU supports it; other compilers need to be targeting AVX2 already
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NESTURBIA_HAS_AVX2
+#define NESTURBIA_AVX2_FUNCTION __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define NESTURBIA_HAS_AVX2
+#define NESTURBIA_AVX2_FUNCTION
+#include <immintrin.h>
+#endif
+
+namespace nesturbia {
+
+namespace {
+
+// The colors of every palette index, in the output's byte order
+using packed_colors_t = std::array<uint32_t, Palette::kNumColors>;
+
+// Converts one row of palette indexes, and scales it up horizontally
+using convert_row_t = void (*)(const packed_colors_t &colors, const uint16_t *indexes,
+                               size_t width, uint32_t scale, uint32_t *output);
+
+constexpr uint32_t kIndexMask = Palette::kNumColors - 1;
+
+// TODO: see if this is 'correct'
+constexpr std::array<uint32_t, 64> kRgbTable = {
+    0x545454, 0x001e74, 0x081090, 0x300088, 0x440064, 0x5c0030, 0x540400, 0x3c1800,
+    0x202a00, 0x083a00, 0x004000, 0x003c00, 0x00323c, 0x000000, 0x000000, 0x000000,
+    0x989698, 0x084cc4, 0x3032ec, 0x5c1ee4, 0x8814b0, 0xa01464, 0x982220, 0x783c00,
+    0x545a00, 0x287200, 0x087c00, 0x007628, 0x006678, 0x000000, 0x000000, 0x000000,
+    0xeceeec, 0x4c9aec, 0x787cec, 0xb062ec, 0xe454ec, 0xec58b4, 0xec6a64, 0xd48820,
+    0xa0aa00, 0x74c400, 0x4cd020, 0x38cc6c, 0x38b4cc, 0x3c3c3c, 0x000000, 0x000000,
+    0xeceeec, 0xa8ccec, 0xbcbcec, 0xd4b2ec, 0xecaeec, 0xecaed4, 0xecb4b0, 0xe4c490,
+    0xccd278, 0xb4de78, 0xa8e290, 0x98e2b4, 0xa0d6e4, 0xa0a2a0, 0x000000, 0x000000};
+
+// How much each emphasis bit darkens the color components other than its own
+constexpr double kEmphasisAttenuation = 0.816328;
+
+void convertRowScalar(const packed_colors_t &colors, const uint16_t *indexes, size_t width,
+                      uint32_t scale, uint32_t *output) {
+  for (size_t x = 0; x < width; x++) {
+    const auto color = colors[indexes[x] & kIndexMask];
+    for (uint32_t i = 0; i < scale; i++) {
+      *output++ = color;
+    }
+  }
+}
+
+#ifdef NESTURBIA_HAS_SSE2
+void convertRowSse2(const packed_colors_t &colors, const uint16_t *indexes, size_t width,
+                    uint32_t scale, uint32_t *output) {
+  // SSE2 can't look up the colors (there's no gather), but it can duplicate and store them
+  size_t x = 0;
+  for (; x + 4 <= width; x += 4) {
+    const auto pixels = _mm_set_epi32(static_cast<int>(colors[indexes[x + 3] & kIndexMask]),
+                                      static_cast<int>(colors[indexes[x + 2] & kIndexMask]),
+                                      static_cast<int>(colors[indexes[x + 1] & kIndexMask]),
+                                      static_cast<int>(colors[indexes[x + 0] & kIndexMask]));
+
+    auto *out = reinterpret_cast<__m128i *>(output);
+    if (scale == 1) {
+      _mm_storeu_si128(out, pixels);
+    } else if (scale == 2) {
+      // aabb ccdd
+      _mm_storeu_si128(out + 0, _mm_unpacklo_epi32(pixels, pixels));
+      _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(pixels, pixels));
+    } else {
+      // aaab bbcc cddd
+      _mm_storeu_si128(out + 0, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+      _mm_storeu_si128(out + 1, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+      _mm_storeu_si128(out + 2, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+    }
+
+    output += 4 * scale;
+  }
+
+  convertRowScalar(colors, indexes + x, width - x, scale, output);
+}
+#endif
+
+#ifdef NESTURBIA_HAS_AVX2
+NESTURBIA_AVX2_FUNCTION void convertRowAvx2(const packed_colors_t &colors,
+                                            const uint16_t *indexes, size_t width,
+                                            uint32_t scale, uint32_t *output) {
+  const auto *table = reinterpret_cast<const int *>(colors.data());
+  const auto indexMask = _mm256_set1_epi32(kIndexMask);
+
+  size_t x = 0;
+  for (; x + 8 <= width; x += 8) {
+    // Widen 8 indexes to 32 bits, and look up all of their colors at once
+    const auto indexes16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indexes + x));
+    const auto offsets = _mm256_and_si256(_mm256_cvtepu16_epi32(indexes16), indexMask);
+    const auto pixels = _mm256_i32gather_epi32(table, offsets, 4);
+
+    auto *out = reinterpret_cast<__m256i *>(output);
+    if (scale == 1) {
+      _mm256_storeu_si256(out, pixels);
+    } else if (scale == 2) {
+      const auto low = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+      const auto high = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+      _mm256_storeu_si256(out + 0, _mm256_permutevar8x32_epi32(pixels, low));
+      _mm256_storeu_si256(out + 1, _mm256_permutevar8x32_epi32(pixels, high));
+    } else {
+      const auto low = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+      const auto middle = _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+      const auto high = _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+      _mm256_storeu_si256(out + 0, _mm256_permutevar8x32_epi32(pixels, low));
+      _mm256_storeu_si256(out + 1, _mm256_permutevar8x32_epi32(pixels, middle));
+      _mm256_storeu_si256(out + 2, _mm256_permutevar8x32_epi32(pixels, high));
+    }
+
+    output += 8 * scale;
+  }
+
+  convertRowScalar(colors, indexes + x, width - x, scale, output);
+}
+#endif
+
+} // namespace
+
+Palette::Palette() {
+  for (uint32_t index = 0; index < kNumColors; index++) {
+    const auto rgb = kRgbTable[index & 0x3f];
+    const auto emphasis = index >> 6;
+
+    uint32_t color = 0;
+    for (uint32_t component = 0; component < 3; component++) {
+      // Components from red (emphasis bit 0) to blue (emphasis bit 2)
+      const auto shift = 16 - component * 8;
+      auto value = static_cast<double>((rgb >> shift) & 0xff);
+
+      for (uint32_t bit = 0; bit < 3; bit++) {
+        if (bit != component && (emphasis & (1U << bit)) != 0) {
+          value *= kEmphasisAttenuation;
+        }
+      }
+
+      color |= static_cast<uint32_t>(std::lround(value)) << shift;
+    }
+
+    colors[index] = color;
+  }
+}
+
+void Palette::Convert(const uint16_t *indexes, size_t numPixels, format_t format,
+                      uint8_t *output) const {
+  // The component order in memory
+  const bool isRgb = format != format_t::bgra;
+  const auto firstShift = isRgb ? 16U : 0U;
+  const auto lastShift = isRgb ? 0U : 16U;
+
+  for (size_t i = 0; i < numPixels; i++) {
+    const auto color = colors[indexes[i] & (kNumColors - 1)];
+
+    output[0] = static_cast<uint8_t>(color >> firstShift);
+    output[1] = static_cast<uint8_t>(color >> 8);
+    output[2] = static_cast<uint8_t>(color >> lastShift);
+
+    if (format == format_t::rgb) {
+      output += 3;
+    } else {
+      output[3] = 0xff;
+      output += 4;
+    }
+  }
+}
+
+void Palette::ConvertFrame(const uint16_t *indexes, size_t width, size_t height, format_t format,
+                           uint32_t scale, uint32_t *output) const {
+  assert(format != format_t::rgb && scale != 0);
+
+  // Lay out the colors the way they're written, so that each pixel is a single lookup
+  packed_colors_t packedColors;
+  for (uint32_t i = 0; i < kNumColors; i++) {
+    const auto color = colors[i];
+    const bool isRgba = format == format_t::rgba;
+
+    const std::array<uint8_t, 4> bytes = {
+        static_cast<uint8_t>(color >> (isRgba ? 16 : 0)),
+        static_cast<uint8_t>(color >> 8),
+        static_cast<uint8_t>(color >> (isRgba ? 0 : 16)),
+        0xff,
+    };
+
+    std::memcpy(&packedColors[i], bytes.data(), bytes.size());
+  }
+
+  convert_row_t convertRow = convertRowScalar;
+  if (scale <= 3) {
+    switch (instructionSet) {
+#ifdef NESTURBIA_HAS_SSE2
+    case instruction_set_t::sse2:
+      convertRow = convertRowSse2;
+      break;
+#endif
+
+#ifdef NESTURBIA_HAS_AVX2
+    case instruction_set_t::avx2:
+      convertRow = convertRowAvx2;
+      break;
+#endif
+
+    default:
+      break;
+    }
+  }
+
+  const auto outputWidth = width * scale;
+  for (size_t y = 0; y < height; y++) {
+    auto *row = output + y * scale * outputWidth;
+    convertRow(packedColors, indexes + y * width, width, scale, row);
+
+    // The rest of the rows are copies of the first one (which is still in the cache)
+    for (uint32_t i = 1; i < scale; i++) {
+      std::memcpy(row + i * outputWidth, row, outputWidth * sizeof(uint32_t));
+    }
+  }
+}
+
+Palette::instruction_set_t Palette::BestInstructionSet() {
+#if defined(NESTURBIA_HAS_AVX2) && defined(__GNUC__)
+  // This may run before the constructors that set up __builtin_cpu_supports() (e.g., for a static
+  // Palette), in which case it must be initialized first
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return instruction_set_t::avx2;
+  }
+#elif defined(NESTURBIA_HAS_AVX2)
+  return instruction_set_t::avx2;
+#endif
+
+#ifdef NESTURBIA_HAS_SSE2
+  return instruction_set_t::sse2;
+#else
+  return instruction_set_t::scalar;
+#endif
+}
+
+} // namespace nesturbia
@@ -1,29 +1,18 @@
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <utility>
 
 #include "nesturbia/ppu.hpp"
 
 namespace nesturbia {
 
-namespace {
-
-// TODO: see if this is 'correct' and allow other palettes to be used
-constexpr std::array<uint32_t, 64> kRgbTable = {
-    0x545454, 0x001e74, 0x081090, 0x300088, 0x440064, 0x5c0030, 0x540400, 0x3c1800,
-    0x202a00, 0x083a00, 0x004000, 0x003c00, 0x00323c, 0x000000, 0x000000, 0x000000,
-    0x989698, 0x084cc4, 0x3032ec, 0x5c1ee4, 0x8814b0, 0xa01464, 0x982220, 0x783c00,
-    0x545a00, 0x287200, 0x087c00, 0x007628, 0x006678, 0x000000, 0x000000, 0x000000,
-    0xeceeec, 0x4c9aec, 0x787cec, 0xb062ec, 0xe454ec, 0xec58b4, 0xec6a64, 0xd48820,
-    0xa0aa00, 0x74c400, 0x4cd020, 0x38cc6c, 0x38b4cc, 0x3c3c3c, 0x000000, 0x000000,
-    0xeceeec, 0xa8ccec, 0xbcbcec, 0xd4b2ec, 0xecaeec, 0xecaed4, 0xecb4b0, 0xe4c490,
-    0xccd278, 0xb4de78, 0xa8e290, 0x98e2b4, 0xa0d6e4, 0xa0a2a0, 0x000000, 0x000000};
-
-uint16 nametableMap(Mapper::mirror_t mirrorType, uint16 address);
-
-} // namespace
-
-Ppu::Ppu(Cartridge &cartridge, nmi_callback_t nmiCallback)
-    : cartridge(cartridge), nmiCallback(std::move(nmiCallback)) {}
+Ppu::Ppu(Cartridge &cartridge, nmi_callback_t nmiCallback, irq_callback_t irqCallback)
+    : cartridge(cartridge), nmiCallback(std::move(nmiCallback)),
+      irqCallback(std::move(irqCallback)) {
+  UpdateNametables();
+  UpdateChrPages();
+}
 
 void Ppu::Power() {
   ctrl = 0;
@@ -50,6 +39,10 @@ void Ppu::Power() {
   vramAddrLatch.value = 0;
 
   fineX = 0;
+
+  // A different ROM may have been loaded
+  UpdateNametables();
+  UpdateChrPages();
 }
 
 bool Ppu::Tick() {
@@ -66,7 +59,16 @@ bool Ppu::Tick() {
       status.vblankStarted = false;
     }
 
-    if (scanline < 240 && dot >= 2 && dot <= 257) {
+    if (scanlineCounter) {
+      // A rise dot of 0 means that A12 doesn't rise at all
+      const auto riseDot = a12RiseDot();
+      if (riseDot != 0 && dot == riseDot) {
+        clockScanlineCounter();
+      }
+    }
+
+    // Without any output, the pixels only matter if they can result in a sprite 0 hit
+    if (scanline < 240 && dot >= 2 && dot <= 257 && (isOutputEnabled || isSprite0HitPossible())) {
       const uint8 x = dot - 2;
       uint8 paletteIndex = 0;
       uint8 objPalette = 0;
@@ -91,25 +93,21 @@ bool Ppu::Tick() {
           // PPUMASK has a bit that prevents rendering sprites in the first 8 pixels
           // If that bit isn't set, then don't render sprites in those pixels
           if (mask.showSpritesInLeftmost8Px || x >= 8) {
-            for (int i = 7; i >= 0; i--) {
+            // Without any output, only sprite 0 matters
+            for (int i = isOutputEnabled ? 7 : 0; i >= 0; i--) {
               if (oamPrimary[i].id == 64) {
                 // Empty entry
                 continue;
               }
 
-              unsigned sprX = x - oamPrimary[i].x;
+              const unsigned sprX = x - oamPrimary[i].x;
               if (sprX >= 8) {
                 // Out of range
                 continue;
               }
 
-              if (oamPrimary[i].attributes.bit(6)) {
-                // Horizontal flipping
-                sprX ^= 7;
-              }
-
-              uint8 sprPalette = oamPrimary[i].dataH.bit(7 - sprX) << 1;
-              sprPalette |= oamPrimary[i].dataL.bit(7 - sprX);
+              // Already flipped horizontally if needed
+              uint8 sprPalette = oamPrimary[i].pixels[sprX];
               if (sprPalette == 0) {
                 // Transparent pixel
                 continue;
@@ -131,24 +129,24 @@ bool Ppu::Tick() {
         paletteIndex = objPalette;
       }
 
-      const auto rgb = kRgbTable[read(0x3f00 | paletteIndex)];
-      uint8 *pixel = &pixels[(scanline * 256 + x) * 3];
+      if (isOutputEnabled) {
+        const auto index = colorIndex(paletteIndex);
 
-      pixel[0] = (rgb >> 16) & 0xff;
-      pixel[1] = (rgb >> 8) & 0xff;
-      pixel[2] = (rgb >> 0) & 0xff;
+        if (pixelFormat == pixel_format_t::indexed) {
+          indexedPixels[scanline * 256 + x] = index;
+        } else {
+          const auto rgb = palette.colors[index];
+          uint8 *pixel = &pixels[(scanline * 256 + x) * 3];
+
+          pixel[0] = (rgb >> 16) & 0xff;
+          pixel[1] = (rgb >> 8) & 0xff;
+          pixel[2] = (rgb >> 0) & 0xff;
+        }
+      }
     }
 
     if (dot == 1) {
-      for (auto &entry : oamSecondary) {
-        entry.id = 64;
-        entry.y = 0xFF;
-        entry.tile = 0xFF;
-        entry.attributes = 0xFF;
-        entry.x = 0xFF;
-        entry.dataL = 0;
-        entry.dataH = 0;
-      }
+      clearSecondaryOam();
 
       renderData.address = 0x2000 | (vramAddr.value & 0xfff);
     } else if ((dot >= 2 && dot <= 255) || (dot >= 322 && dot <= 337)) {
@@ -201,11 +199,7 @@ bool Ppu::Tick() {
         renderData.bgH = read(renderData.address);
 
         if (mask.showBackground || mask.showSprites) {
-          if (vramAddr.fields.coarseX == 31) {
-            vramAddr.value ^= 0x41f;
-          } else {
-            vramAddr.fields.coarseX++;
-          }
+          incrementCoarseX();
         }
         break;
       }
@@ -213,64 +207,22 @@ bool Ppu::Tick() {
       renderData.bgH = read(renderData.address);
 
       if (mask.showBackground || mask.showSprites) {
-        if (++vramAddr.fields.fineY == 0x0) {
-          if (vramAddr.fields.coarseY == 0x1f) {
-            vramAddr.fields.coarseY = 0;
-          } else if (vramAddr.fields.coarseY == 0x1d) {
-            vramAddr.fields.coarseY = 0;
-            vramAddr.fields.nametable ^= 0x2;
-          } else {
-            ++vramAddr.fields.coarseY;
-          }
-        }
+        incrementFineY();
       }
     } else if (dot == 257) {
       if (scanline != 261) {
-        // Evaluate sprites
-        if (mask.showBackground || mask.showSprites) {
-          uint8 spriteCount = 0;
-          for (uint8 i = 0; i < 64; i++) {
-            auto y = oam[i * 4 + 0];
-            int row = (int)scanline - y;
-            if (row < 0 || row >= ctrl.spriteHeight) {
-              continue;
-            }
-
-            if (spriteCount < 8) {
-              auto &oamSecondaryEntry = oamSecondary[spriteCount];
-
-              oamSecondaryEntry.id = i;
-              oamSecondaryEntry.y = y;
-              oamSecondaryEntry.tile = oam[i * 4 + 1];
-              oamSecondaryEntry.attributes = oam[i * 4 + 2];
-              oamSecondaryEntry.x = oam[i * 4 + 3];
-            }
-
-            if (++spriteCount == 9) {
-              // TODO: make a test for this case (somehow)
-              status.spriteOverflow = true;
-            }
-          }
-        }
+        evaluateSprites();
       }
 
       renderData.atLatchL = renderData.attributeByte.bit(0);
       renderData.atLatchH = renderData.attributeByte.bit(1);
 
       if (mask.showBackground || mask.showSprites) {
-        vramAddr.fields.coarseX = vramAddrLatch.fields.coarseX;
-
-        vramAddr.fields.nametable &= 0x2;
-        vramAddr.fields.nametable |= vramAddrLatch.fields.nametable & 0x1;
+        copyHorizontalPosition();
       }
     } else if (dot >= 280 && dot <= 304) {
       if (scanline == 261 && (mask.showBackground || mask.showSprites)) {
-        vramAddr.fields.coarseY = vramAddrLatch.fields.coarseY;
-
-        vramAddr.fields.nametable &= 0x1;
-        vramAddr.fields.nametable |= vramAddrLatch.fields.nametable & 0x2;
-
-        vramAddr.fields.fineY = vramAddrLatch.fields.fineY;
+        copyVerticalPosition();
       }
     } else if (dot == 321) {
       // Load sprites
@@ -292,8 +244,16 @@ bool Ppu::Tick() {
 
         address += spriteY + (spriteY & 8);
 
-        oamPrimary[i].dataL = read(address);
-        oamPrimary[i].dataH = read(address + 8);
+        // Empty entries are fetched too, but there's nothing to decode for them
+        // The row is decoded before the fetches, since the mapper may switch banks after them
+        if (oamPrimary[i].id != 64) {
+          oamPrimary[i].pixels = decodedTileRow(address, oamPrimary[i].attributes.bit(6));
+        }
+
+        if (ppuAddressObserver) {
+          observeChrAccess(address);
+          observeChrAccess(address + 8);
+        }
       }
 
       renderData.address = 0x2000 | (vramAddr.value & 0xfff);
@@ -334,6 +294,85 @@ bool Ppu::Tick() {
   return updateFrame;
 }
 
+bool Ppu::Run(uint32_t dots) {
+  // The number of dots in a line that renderScanline() handles (the rest are fetches for the next
+  // line, which are left to Tick())
+  constexpr auto kScanlineRenderDots = 321U;
+
+  constexpr auto kVblankStartDot = 241U * 341U + 1U;
+  constexpr auto kPreRenderLineDot = 261U * 341U;
+
+  bool updateFrame = false;
+
+  while (dots != 0) {
+    if (renderer == renderer_t::scanline) {
+      if (scanline < 240 && dot <= 1 && dots >= kScanlineRenderDots - dot && !ppuAddressObserver) {
+        // The PPU is always caught up before it's accessed, so nothing can change its state before
+        // the end of this line's visible dots; it's safe to draw the whole line at once
+        // (this doesn't make the CHR fetches one by one, so mappers that watch them need Tick())
+        dots -= kScanlineRenderDots - dot;
+        renderScanline();
+        continue;
+      }
+
+      if (scanline >= 240 && scanline <= 260) {
+        // Other than the frame completing and VBLANK starting, nothing happens until line 261
+        const auto currentDot = scanline * 341U + dot;
+        if (currentDot != 240U * 341U && currentDot != kVblankStartDot) {
+          const auto endDot = currentDot < kVblankStartDot ? kVblankStartDot : kPreRenderLineDot;
+          const auto skippedDots = std::min(dots, endDot - currentDot);
+
+          dots -= skippedDots;
+          scanline = (currentDot + skippedDots) / 341U;
+          dot = (currentDot + skippedDots) % 341U;
+          continue;
+        }
+      }
+    }
+
+    if (Tick()) {
+      updateFrame = true;
+    }
+
+    --dots;
+  }
+
+  return updateFrame;
+}
+
+uint32_t Ppu::DotsUntilNextEvent() const {
+  // Events are things that the PPU does on its own that are observable outside of it:
+  // * Line 240, dot 0: the frame is complete
+  // * Line 241, dot 1: VBLANK starts (and an NMI may be triggered)
+  // * The mapper's scanline counter raises an IRQ
+  // Everything else is only observable by accessing the PPU, so the PPU can safely run behind the
+  // CPU until one of these events or a PPU access occurs
+  constexpr auto kDotsPerFrame = 262U * 341U;
+  const std::array<uint32_t, 3> eventDots = {240U * 341U + 0U, 241U * 341U + 1U,
+                                             scanlineCounter ? scanlineIrqDot() : 0U};
+
+  const auto currentDot = scanline * 341U + dot;
+
+  // If the frame wraps around before the event, odd frames skip a dot when rendering is enabled
+  const auto skippedDot = (mask.showBackground || mask.showSprites) && isOddFrame ? 1U : 0U;
+
+  auto dots = kDotsPerFrame;
+  for (const auto eventDot : eventDots) {
+    if (eventDot == 0) {
+      // No IRQ
+      continue;
+    }
+
+    const auto dotsToEvent = eventDot >= currentDot
+                                 ? eventDot - currentDot
+                                 : kDotsPerFrame - currentDot + eventDot - skippedDot;
+    dots = std::min(dots, dotsToEvent);
+  }
+
+  // Tick() handles the current dot before advancing, so the event's dot needs one more tick
+  return dots + 1;
+}
+
 uint8 Ppu::ReadRegister(uint16 address) {
   assert(address >= 0x2000 && address < 0x4000);
 
@@ -455,11 +494,20 @@ void Ppu::WriteRegister(uint16 address, uint8 value) {
   case 0x2007:
     // PPUDATA
     if (vramAddr.address < 0x2000) {
-      // Write mapper CHR-ROM/RAM
-      cartridge.WriteCHR(vramAddr.address, value);
+      // Write mapper CHR-RAM
+      if (auto *page = chrWritePages[vramAddr.address >> 10]) {
+        page[vramAddr.address & 0x3ff] = value;
+        ++cartridge.chrGeneration;
+      } else {
+        cartridge.WriteCHR(vramAddr.address, value);
+      }
+
+      if (ppuAddressObserver) {
+        observeChrAccess(vramAddr.address);
+      }
     } else if (vramAddr.address < 0x3f00) {
       // Nametable RAM
-      vram[nametableMap(cartridge.GetMirrorType(), vramAddr.address)] = value;
+      nametables[(vramAddr.address >> 10) & 0x3][vramAddr.address & 0x3ff] = value;
     } else {
       // Palette memory ($3f00-$3eff)
       // $3f00-$3f1f are mirrored up to $3fff
@@ -479,18 +527,103 @@ void Ppu::WriteRegister(uint16 address, uint8 value) {
   }
 }
 
+void Ppu::WriteOamDma(const uint8 *data) {
+  // The bytes go from OAMADDR onwards (wrapping around), which leaves OAMADDR where it was
+  const size_t start = oamaddr;
+  std::memcpy(&oam[start], data, oam.size() - start);
+  std::memcpy(oam.data(), data + (oam.size() - start), start);
+}
+
+void Ppu::UpdateNametables() {
+  auto *lower = &vram[0x000];
+  auto *upper = &vram[0x400];
+
+  switch (cartridge.GetMirrorType()) {
+  case Mapper::mirror_t::horizontal:
+    // $2000 = $2400, $2800 = $2c00
+    nametables = {lower, lower, upper, upper};
+    break;
+
+  case Mapper::mirror_t::vertical:
+    // $2000 = $2800, $2400 = $2c00
+    nametables = {lower, upper, lower, upper};
+    break;
+
+  case Mapper::mirror_t::oneScreenLower:
+    nametables = {lower, lower, lower, lower};
+    break;
+
+  case Mapper::mirror_t::oneScreenHigher:
+    nametables = {upper, upper, upper, upper};
+    break;
+
+  case Mapper::mirror_t::fourScreen:
+    nametables = {lower, upper, &cartridge.fourScreenVram[0x000], &cartridge.fourScreenVram[0x400]};
+    break;
+  }
+}
+
+void Ppu::UpdateChrPages() {
+  auto *mapper = cartridge.mapper.get();
+  if (!mapper) {
+    chrReadPages = {};
+    chrWritePages = {};
+    ppuAddressObserver = nullptr;
+    scanlineCounter = nullptr;
+    return;
+  }
+
+  chrReadPages = mapper->chrBanks;
+  chrWritePages = mapper->chrWriteBanks;
+  ppuAddressObserver = mapper->observesPpuAddress ? mapper : nullptr;
+  scanlineCounter = mapper->countsScanlines ? mapper : nullptr;
+}
+
+void Ppu::Serialize(Serializer &serializer) {
+  serializer(ctrl);
+  serializer(mask);
+  serializer(status);
+  serializer(oamaddr);
+
+  serializer(scanline);
+  serializer(dot);
+  serializer(isOddFrame);
+
+  serializer(addressWriteLatch);
+  serializer(latchedValue);
+  serializer(readBuffer);
+  serializer(vramAddr);
+  serializer(vramAddrLatch);
+  serializer(fineX);
+
+  serializer(vram);
+  serializer(oam);
+  serializer(oamPrimary);
+  serializer(oamSecondary);
+  serializer(paletteRam);
+
+  serializer(renderData);
+}
+
 // TODO put in anonymous namespace?
 uint8 Ppu::read(uint16 address) {
   assert(address < 0x4000);
 
   if (address < 0x2000) {
     // Read mapper CHR-ROM/RAM
-    return cartridge.ReadCHR(address);
+    const auto value = readChr(address);
+
+    // The mapper sees the access after it's done (e.g., MMC2 switches banks after the fetch)
+    if (ppuAddressObserver) {
+      observeChrAccess(address);
+    }
+
+    return value;
   }
 
   if (address < 0x3f00) {
     // Nametable RAM
-    return vram[nametableMap(cartridge.GetMirrorType(), address)];
+    return nametables[(address >> 10) & 0x3][address & 0x3ff];
   }
 
   // Palette memory ($3f00-$3eff)
@@ -505,29 +638,377 @@ uint8 Ppu::read(uint16 address) {
   return paletteRam[paletteAddr];
 }
 
-namespace {
+uint8 Ppu::readChr(uint16 address) const {
+  if (const auto *page = chrReadPages[address >> 10]) {
+    return page[address & 0x3ff];
+  }
 
-uint16 nametableMap(Mapper::mirror_t mirrorType, uint16 address) {
-  switch (mirrorType) {
-  case Mapper::mirror_t::horizontal:
-    // Horizontal mapping ties address bit A11 to A10 in the mapper
-    return ((address >> 1) & 0x400) | (address & 0x3ff);
+  return cartridge.ReadCHR(address);
+}
 
-  case Mapper::mirror_t::vertical:
-    return address & 0x7ff;
+void Ppu::observeChrAccess(uint16 address) {
+  if (ppuAddressObserver->ObservePpuAddress(address)) {
+    // The mapper switched banks
+    UpdateChrPages();
+  }
+}
 
-  case Mapper::mirror_t::oneScreenLower:
-    return address & 0x3ff;
+uint32_t Ppu::a12RiseDot() const {
+  // A12 is the pattern table bit of CHR addresses, so it only rises when the tiles of the next
+  // line (dots 321-336) and its sprites (dots 257-320) come from different pattern tables
+  // The mapper filters out the short pulses in between fetches, which leaves one rise per line:
+  // * Background at $0000, sprites at $1000: dot 260
+  // * Background at $1000, sprites at $0000: dot 324
+  // 8x16 sprites are assumed to come from $1000, which is where the unused sprites' tile ($ff) is
+  // Returns 0 when A12 doesn't rise (dot 0 is idle, so it's never a rise dot)
+  if (!mask.showBackground && !mask.showSprites) {
+    return 0;
+  }
 
-  case Mapper::mirror_t::oneScreenHigher:
-    return 0x400 | (address & 0x3ff);
+  const bool isBackgroundHigh = ctrl.backgroundTableAddr == 0x1000;
+  const bool areSpritesHigh = ctrl.spriteHeight == 16 || ctrl.spriteTableAddr == 0x1000;
+  if (isBackgroundHigh == areSpritesHigh) {
+    return 0;
+  }
 
-  default:
-    // TODO: handle other types for MMC1 (and potentially others)
-    return address & 0x7ff;
+  return areSpritesHigh ? 260 : 324;
+}
+
+uint32_t Ppu::scanlineIrqDot() const {
+  // Returns the dot of the frame (scanline * 341 + dot) at which the scanline counter raises an
+  // IRQ, if it does so within a frame, or 0 otherwise
+  const auto riseDot = a12RiseDot();
+  auto numClocks = scanlineCounter->ScanlinesUntilIrq();
+  if (riseDot == 0 || numClocks == 0) {
+    return 0;
   }
+
+  // Anything that changes the rise dot or the counter is a PPU or mapper write, which schedules
+  // the events again, so until then the counter is clocked once on every rendered line
+  for (uint32_t i = 0; i < 262; i++) {
+    const auto line = (scanline + i) % 262;
+    const bool isRenderedLine = line < 240 || line == 261;
+    if (!isRenderedLine || (i == 0 && dot > riseDot)) {
+      continue;
+    }
+
+    if (--numClocks == 0) {
+      return line * 341 + riseDot;
+    }
+  }
+
+  return 0;
 }
 
-} // namespace
+void Ppu::clockScanlineCounter() {
+  if (scanlineCounter->ClockScanline() && irqCallback) {
+    irqCallback();
+  }
+}
+
+bool Ppu::isSprite0HitPossible() const {
+  // Sprite 0 is always evaluated first, so it's in the first entry if it's on the current line
+  return !status.sprite0Hit && mask.showBackground && mask.showSprites && oamPrimary[0].id == 0;
+}
+
+uint16_t Ppu::colorIndex(uint8 paletteIndex) {
+  // Grayscale only keeps the brightness (the top 2 bits) of the color
+  auto index = static_cast<uint16_t>(read(0x3f00 | paletteIndex) & (mask.grayscale ? 0x30 : 0x3f));
+
+  index |= mask.emphasizeRed << 6;
+  index |= mask.emphasizeGreen << 7;
+  index |= mask.emphasizeBlue << 8;
+
+  return index;
+}
+
+void Ppu::renderScanline() {
+  // Does the same thing as calling Tick() for each dot from the current one up to dot 320 of a
+  // visible line
+  const bool isRendering = mask.showBackground || mask.showSprites;
+
+  clearSecondaryOam();
+
+  if (isOutputEnabled || isSprite0HitPossible()) {
+    drawScanline();
+  }
+
+  // Update everything else the same way as Tick() would have
+  if (isRendering) {
+    // Dots 8, 16, ..., 248
+    for (int i = 0; i < 31; i++) {
+      incrementCoarseX();
+    }
+
+    // Dot 256
+    incrementFineY();
+  }
+
+  // Dot 257
+  evaluateSprites();
+
+  if (isRendering) {
+    copyHorizontalPosition();
+  }
+
+  // Dot 260 (an IRQ can't be raised here, since that would be an event that the scanline renderer
+  // stops at)
+  if (scanlineCounter && a12RiseDot() == 260) {
+    clockScanlineCounter();
+  }
+
+  // The rest of the line (fetching the next line's sprites and tiles) is left to Tick()
+  dot = 321;
+}
+
+void Ppu::drawScanline() {
+  // Background palette indexes (0 is transparent)
+  std::array<uint8_t, kScreenWidth> background = {};
+
+  if (mask.showBackground) {
+    // The 2-bit pattern + attribute of every pixel from the 33 tiles that the line can touch
+    // Since the first two tiles were fetched at the end of the previous line, they're in the shift
+    // registers; the others are fetched the same way as Tick() does it
+    std::array<uint8_t, 33 * 8> tilePixels;
+
+    for (int i = 0; i < 16; i++) {
+      const uint8_t pattern =
+          renderData.bgShiftH.bit(15 - i) << 1 | renderData.bgShiftL.bit(15 - i);
+
+      // The first tile's attribute is in the shift registers, and the second one's is latched
+      uint8_t attribute = renderData.atLatchH << 1 | renderData.atLatchL;
+      if (i < 8) {
+        attribute = renderData.atShiftH.bit(7 - i) << 1 | renderData.atShiftL.bit(7 - i);
+      }
+
+      tilePixels[i] = pattern ? (attribute << 2) | pattern : 0;
+    }
+
+    addr_t addr = vramAddr;
+    for (unsigned tile = 2; tile < 33; tile++) {
+      const uint8 nametableByte = read(0x2000 | (addr.value & 0xfff));
+
+      uint16 attributeAddr = 0x23c0;
+      attributeAddr |= addr.fields.nametable << 10;
+      attributeAddr |= (addr.fields.coarseY >> 2) << 3;
+      attributeAddr |= (addr.fields.coarseX >> 2);
+
+      uint8 attribute = read(attributeAddr);
+      attribute >>= addr.fields.coarseY & 0x2 ? 4 : 0;
+      attribute >>= addr.fields.coarseX & 0x2 ? 2 : 0;
+
+      const auto &row = decodedTileRow(
+          ctrl.backgroundTableAddr + (nametableByte << 4) + addr.fields.fineY, false);
+
+      const uint8_t palette = (attribute & 3) << 2;
+      for (int i = 0; i < 8; i++) {
+        tilePixels[tile * 8 + i] = row[i] ? palette | row[i] : 0;
+      }
+
+      if (addr.fields.coarseX == 31) {
+        addr.value ^= 0x41f;
+      } else {
+        addr.fields.coarseX++;
+      }
+    }
+
+    // The shift registers don't shift on the last pixel, so it repeats the previous one's position
+    for (unsigned x = mask.showBackgroundInLeftmost8Px ? 0 : 8; x < kScreenWidth; x++) {
+      background[x] = tilePixels[std::min(x, kScreenWidth - 2) + fineX];
+    }
+  }
+
+  // Sprite palette indexes (0 is transparent)
+  // Bit 7 is set if the sprite is behind the background
+  std::array<uint8_t, kScreenWidth> sprites = {};
+
+  if (mask.showSprites) {
+    // Draw from the last sprite to the first, since lower sprite indexes have priority
+    // Without any output, only sprite 0 matters
+    for (int i = isOutputEnabled ? 7 : 0; i >= 0; i--) {
+      const auto &entry = oamPrimary[i];
+      if (entry.id == 64) {
+        // Empty entry
+        continue;
+      }
+
+      for (unsigned sprX = 0; sprX < 8; sprX++) {
+        const unsigned x = entry.x + sprX;
+        if (x >= kScreenWidth) {
+          break;
+        }
+
+        if (x < 8 && !mask.showSpritesInLeftmost8Px) {
+          continue;
+        }
+
+        const auto pattern = entry.pixels[sprX];
+        if (pattern == 0) {
+          // Transparent pixel
+          continue;
+        }
+
+        if (entry.id == 0 && background[x] && x != 255) {
+          status.sprite0Hit = true;
+        }
+
+        sprites[x] = 0x10 | ((entry.attributes & 3) << 2) | pattern;
+        sprites[x] |= entry.attributes.bit(5) ? 0x80 : 0x00;
+      }
+    }
+  }
+
+  if (!isOutputEnabled) {
+    // Only drawn for the sprite 0 hit
+    return;
+  }
+
+  // The palette (and PPUMASK) can't change midway through the line
+  std::array<uint16_t, 0x20> indexes;
+  for (uint8_t i = 0; i < indexes.size(); i++) {
+    indexes[i] = colorIndex(i);
+  }
+
+  if (pixelFormat == pixel_format_t::indexed) {
+    uint16_t *pixel = &indexedPixels[scanline * kScreenWidth];
+    for (unsigned x = 0; x < kScreenWidth; x++) {
+      auto paletteIndex = background[x];
+      if (sprites[x] && (paletteIndex == 0 || !(sprites[x] & 0x80))) {
+        paletteIndex = sprites[x] & 0x1f;
+      }
+
+      pixel[x] = indexes[paletteIndex];
+    }
+
+    return;
+  }
+
+  std::array<uint32_t, 0x20> colors;
+  for (uint8_t i = 0; i < colors.size(); i++) {
+    colors[i] = palette.colors[indexes[i]];
+  }
+
+  uint8 *pixel = &pixels[scanline * kScreenWidth * 3];
+  for (unsigned x = 0; x < kScreenWidth; x++) {
+    auto paletteIndex = background[x];
+    if (sprites[x] && (paletteIndex == 0 || !(sprites[x] & 0x80))) {
+      paletteIndex = sprites[x] & 0x1f;
+    }
+
+    const auto rgb = colors[paletteIndex];
+    pixel[0] = (rgb >> 16) & 0xff;
+    pixel[1] = (rgb >> 8) & 0xff;
+    pixel[2] = (rgb >> 0) & 0xff;
+    pixel += 3;
+  }
+}
+
+const std::array<uint8_t, 8> &Ppu::decodedTileRow(uint16 address, bool flipped) {
+  const auto *page = chrReadPages[(address >> 10) & 0x7];
+  const auto *data = page ? page + (address & 0x3f0) : nullptr;
+  auto &tile = tileCache[(address >> 4) & 0x1ff];
+
+  // Tiles that are read through the mapper (without a page) can't be told apart by their data, so
+  // those are always decoded
+  if (!data || tile.data != data || tile.chrGeneration != cartridge.chrGeneration) {
+    // Decode all 8 rows of the tile since the neighboring rows are likely to be used soon
+    const uint16 tileAddress = address & 0x1ff0;
+
+    for (int row = 0; row < 8; row++) {
+      // Decoding isn't a fetch of its own, so the mapper doesn't see these
+      const uint8 patternL = readChr(tileAddress + row);
+      const uint8 patternH = readChr(tileAddress + row + 8);
+
+      for (int x = 0; x < 8; x++) {
+        const uint8_t pattern = patternH.bit(7 - x) << 1 | patternL.bit(7 - x);
+        tile.pixels[row][x] = pattern;
+        tile.flippedPixels[row][7 - x] = pattern;
+      }
+    }
+
+    tile.data = data;
+    tile.chrGeneration = cartridge.chrGeneration;
+  }
+
+  return flipped ? tile.flippedPixels[address & 7] : tile.pixels[address & 7];
+}
+
+void Ppu::clearSecondaryOam() {
+  for (auto &entry : oamSecondary) {
+    entry.id = 64;
+    entry.y = 0xFF;
+    entry.tile = 0xFF;
+    entry.attributes = 0xFF;
+    entry.x = 0xFF;
+    entry.pixels = {};
+  }
+}
+
+void Ppu::evaluateSprites() {
+  if (!mask.showBackground && !mask.showSprites) {
+    return;
+  }
+
+  uint8 spriteCount = 0;
+  for (uint8 i = 0; i < 64; i++) {
+    auto y = oam[i * 4 + 0];
+    int row = (int)scanline - y;
+    if (row < 0 || row >= ctrl.spriteHeight) {
+      continue;
+    }
+
+    if (spriteCount < 8) {
+      auto &oamSecondaryEntry = oamSecondary[spriteCount];
+
+      oamSecondaryEntry.id = i;
+      oamSecondaryEntry.y = y;
+      oamSecondaryEntry.tile = oam[i * 4 + 1];
+      oamSecondaryEntry.attributes = oam[i * 4 + 2];
+      oamSecondaryEntry.x = oam[i * 4 + 3];
+    }
+
+    if (++spriteCount == 9) {
+      // TODO: make a test for this case (somehow)
+      status.spriteOverflow = true;
+    }
+  }
+}
+
+void Ppu::incrementCoarseX() {
+  if (vramAddr.fields.coarseX == 31) {
+    vramAddr.value ^= 0x41f;
+  } else {
+    vramAddr.fields.coarseX++;
+  }
+}
+
+void Ppu::incrementFineY() {
+  if (++vramAddr.fields.fineY == 0x0) {
+    if (vramAddr.fields.coarseY == 0x1f) {
+      vramAddr.fields.coarseY = 0;
+    } else if (vramAddr.fields.coarseY == 0x1d) {
+      vramAddr.fields.coarseY = 0;
+      vramAddr.fields.nametable ^= 0x2;
+    } else {
+      ++vramAddr.fields.coarseY;
+    }
+  }
+}
+
+void Ppu::copyHorizontalPosition() {
+  vramAddr.fields.coarseX = vramAddrLatch.fields.coarseX;
+
+  vramAddr.fields.nametable &= 0x2;
+  vramAddr.fields.nametable |= vramAddrLatch.fields.nametable & 0x1;
+}
+
+void Ppu::copyVerticalPosition() {
+  vramAddr.fields.coarseY = vramAddrLatch.fields.coarseY;
+
+  vramAddr.fields.nametable &= 0x1;
+  vramAddr.fields.nametable |= vramAddrLatch.fields.nametable & 0x2;
+
+  vramAddr.fields.fineY = vramAddrLatch.fields.fineY;
+}
 
 } // namespace nesturbia
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstring>
+
+#include "nesturbia/rewind.hpp"
+
+namespace nesturbia {
+
+namespace {
+
+// Runs of equal bytes shorter than this are stored as part of the literal bytes around them
+constexpr size_t kMinZeroRun = 4;
+
+// Sizes are stored before and after each delta
+constexpr size_t kSizeFieldSize = sizeof(uint32_t);
+
+size_t writeVarint(uint8_t *output, size_t value) {
+  size_t size = 0;
+  while (value >= 0x80) {
+    output[size++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+
+  output[size++] = static_cast<uint8_t>(value);
+  return size;
+}
+
+size_t readVarint(const uint8_t *input, size_t &offset) {
+  size_t value = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    const auto byte = input[offset++];
+    value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+}
+
+// Encodes (newState XOR oldState) as a list of [number of zeros][number of literals][literals]
+// Returns the size of the output
+size_t encodeDelta(const uint8_t *newState, const uint8_t *oldState, size_t stateSize,
+                   uint8_t *output) {
+  size_t outputSize = 0;
+  size_t offset = 0;
+
+  while (offset < stateSize) {
+    const auto zeroRunStart = offset;
+
+    // Skip over the unchanged bytes, 8 at a time where possible
+    while (offset + 8 <= stateSize && std::memcmp(newState + offset, oldState + offset, 8) == 0) {
+      offset += 8;
+    }
+
+    while (offset < stateSize && newState[offset] == oldState[offset]) {
+      ++offset;
+    }
+
+    if (offset == stateSize) {
+      // Trailing zeros don't need to be stored
+      break;
+    }
+
+    // The literals end at the next run of at least kMinZeroRun unchanged bytes
+    auto literalEnd = offset;
+    for (auto i = offset; i < stateSize && i - literalEnd < kMinZeroRun; i++) {
+      if (newState[i] != oldState[i]) {
+        literalEnd = i + 1;
+      }
+    }
+
+    outputSize += writeVarint(output + outputSize, offset - zeroRunStart);
+    outputSize += writeVarint(output + outputSize, literalEnd - offset);
+
+    for (; offset < literalEnd; offset++) {
+      output[outputSize++] = newState[offset] ^ oldState[offset];
+    }
+  }
+
+  return outputSize;
+}
+
+// XORs an encoded delta into the state
+void applyDelta(const uint8_t *delta, size_t deltaSize, uint8_t *state) {
+  size_t offset = 0;
+  size_t stateOffset = 0;
+
+  while (offset < deltaSize) {
+    stateOffset += readVarint(delta, offset);
+
+    const auto numLiterals = readVarint(delta, offset);
+    for (size_t i = 0; i < numLiterals; i++) {
+      state[stateOffset++] ^= delta[offset++];
+    }
+  }
+}
+
+} // namespace
+
+void RewindBuffer::Reset(size_t bufferSize, size_t stateSize) {
+  this->stateSize = stateSize;
+
+  latestState.assign(stateSize, 0);
+  hasLatestState = false;
+
+  deltas.assign(bufferSize, 0);
+  head = 0;
+  tail = 0;
+  usedSize = 0;
+  numDeltas = 0;
+
+  // Worst case: every run of literals is a single byte, followed by the shortest run of zeros
+  // Each run needs two varints (up to 10 bytes each)
+  scratch.assign(stateSize + (stateSize / (kMinZeroRun + 1) + 1) * 20, 0);
+}
+
+size_t RewindBuffer::NumStates() const { return numDeltas; }
+
+void RewindBuffer::Push(const uint8_t *state) {
+  if (deltas.empty()) {
+    return;
+  }
+
+  if (!hasLatestState) {
+    std::memcpy(latestState.data(), state, stateSize);
+    hasLatestState = true;
+    return;
+  }
+
+  // The delta turns the new state back into the previous one
+  const auto deltaSize = encodeDelta(state, latestState.data(), stateSize, scratch.data());
+  std::memcpy(latestState.data(), state, stateSize);
+
+  const auto entrySize = deltaSize + 2 * kSizeFieldSize;
+  if (entrySize > deltas.size()) {
+    // This delta doesn't fit at all, so nothing before this state can be restored anymore
+    head = 0;
+    tail = 0;
+    usedSize = 0;
+    numDeltas = 0;
+    return;
+  }
+
+  while (usedSize + entrySize > deltas.size()) {
+    dropOldestDelta();
+  }
+
+  const auto sizeField = static_cast<uint32_t>(deltaSize);
+  writeDeltas(head, &sizeField, kSizeFieldSize);
+  writeDeltas(head + kSizeFieldSize, scratch.data(), deltaSize);
+  writeDeltas(head + kSizeFieldSize + deltaSize, &sizeField, kSizeFieldSize);
+
+  head = (head + entrySize) % deltas.size();
+  usedSize += entrySize;
+  ++numDeltas;
+}
+
+bool RewindBuffer::Pop(uint8_t *state) {
+  if (numDeltas == 0) {
+    return false;
+  }
+
+  // The newest delta's size is stored right before the head
+  uint32_t deltaSize = 0;
+  readDeltas(head + deltas.size() - kSizeFieldSize, &deltaSize, kSizeFieldSize);
+
+  const auto entrySize = deltaSize + 2 * kSizeFieldSize;
+  const auto entryStart = (head + deltas.size() - entrySize) % deltas.size();
+
+  readDeltas(entryStart + kSizeFieldSize, scratch.data(), deltaSize);
+  applyDelta(scratch.data(), deltaSize, latestState.data());
+
+  head = entryStart;
+  usedSize -= entrySize;
+  --numDeltas;
+
+  std::memcpy(state, latestState.data(), stateSize);
+  return true;
+}
+
+void RewindBuffer::readDeltas(size_t offset, void *data, size_t dataSize) const {
+  offset %= deltas.size();
+
+  // The data may wrap around the end of the ring buffer
+  const auto firstPartSize = std::min(dataSize, deltas.size() - offset);
+  std::memcpy(data, &deltas[offset], firstPartSize);
+  std::memcpy(static_cast<uint8_t *>(data) + firstPartSize, deltas.data(),
+              dataSize - firstPartSize);
+}
+
+void RewindBuffer::writeDeltas(size_t offset, const void *data, size_t dataSize) {
+  offset %= deltas.size();
+
+  const auto firstPartSize = std::min(dataSize, deltas.size() - offset);
+  std::memcpy(&deltas[offset], data, firstPartSize);
+  std::memcpy(deltas.data(), static_cast<const uint8_t *>(data) + firstPartSize,
+              dataSize - firstPartSize);
+}
+
+void RewindBuffer::dropOldestDelta() {
+  uint32_t deltaSize = 0;
+  readDeltas(tail, &deltaSize, kSizeFieldSize);
+
+  const auto entrySize = deltaSize + 2 * kSizeFieldSize;
+  tail = (tail + entrySize) % deltas.size();
+  usedSize -= entrySize;
+  --numDeltas;
+}
+
+} // namespace nesturbia
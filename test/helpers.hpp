@@ -0,0 +1,90 @@
+#ifndef NESTURBIA_TEST_HELPERS_HPP_INCLUDED
+#define NESTURBIA_TEST_HELPERS_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "nesturbia/nesturbia.hpp"
+
+// Fixtures that are shared by the tests
+namespace nesturbia::test {
+
+// Constants
+// An NROM ROM with 16K of PRG-ROM ($8000-$bfff, mirrored at $c000) and 8K of CHR-ROM
+constexpr size_t kPrgRomOffset = 16;
+constexpr size_t kChrRomOffset = kPrgRomOffset + 0x4000;
+constexpr size_t kNromSize = kChrRomOffset + 0x2000;
+
+// Types
+using nrom_t = std::array<uint8_t, kNromSize>;
+
+// Collects the audio that an emulator outputs (see captureAudio())
+struct audio_capture_t {
+  std::array<float, 1024> buffer;
+  std::vector<float> samples;
+};
+
+// Functions
+// Creates an NROM ROM that runs `program` from $8000, with `nmiHandler` (if any) at $8040, so the
+// program must be shorter than that
+// The CHR-ROM is filled with (offset * chrStep)
+inline nrom_t createNrom(const std::vector<uint8_t> &program,
+                         const std::vector<uint8_t> &nmiHandler = {}, uint8_t chrStep = 0) {
+  nrom_t rom = {};
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 1 * 16K
+  rom[4] = 1;
+
+  // CHR-ROM: 1 * 8K
+  rom[5] = 1;
+
+  for (size_t i = 0; i < program.size(); i++) {
+    rom[kPrgRomOffset + i] = program[i];
+  }
+
+  if (!nmiHandler.empty()) {
+    for (size_t i = 0; i < nmiHandler.size(); i++) {
+      rom[kPrgRomOffset + 0x40 + i] = nmiHandler[i];
+    }
+
+    // NMI vector: $8040
+    rom[kPrgRomOffset + 0x3ffa] = 0x40;
+    rom[kPrgRomOffset + 0x3ffb] = 0x80;
+  }
+
+  // Reset vector: $8000
+  rom[kPrgRomOffset + 0x3ffc] = 0x00;
+  rom[kPrgRomOffset + 0x3ffd] = 0x80;
+
+  for (size_t i = 0; i < 0x2000; i++) {
+    rom[kChrRomOffset + i] = static_cast<uint8_t>(i * chrStep);
+  }
+
+  return rom;
+}
+
+// Makes `emulator` append its audio (at 44.1 kHz) to `capture.samples`
+// `capture` must outlive the emulator's use of it
+inline void captureAudio(Nesturbia &emulator, audio_capture_t &capture) {
+  AudioOutput audioOutput;
+  audioOutput.samples = capture.buffer.data();
+  audioOutput.bufferSize = capture.buffer.size();
+  audioOutput.callback = [](void *userData, const float *samples, const int16_t *,
+                            size_t numSamples) {
+    auto &captured = static_cast<audio_capture_t *>(userData)->samples;
+    captured.insert(captured.end(), samples, samples + numSamples);
+  };
+  audioOutput.userData = &capture;
+
+  emulator.SetAudioOutput(audioOutput, 44100);
+}
+
+} // namespace nesturbia::test
+
+#endif // NESTURBIA_TEST_HELPERS_HPP_INCLUDED
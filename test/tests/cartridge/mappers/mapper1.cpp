@@ -1,12 +1,27 @@
 #include <array>
 #include <cstdint>
+#include <vector>
 
 #include "catch2/catch_all.hpp"
 
 #include "nesturbia/cartridge.hpp"
 #include "nesturbia/mappers/mapper1.hpp"
+#include "nesturbia/ppu.hpp"
 using namespace nesturbia;
 
+namespace {
+
+// Writes one of MMC1's internal registers through the shift register
+void writeRegister(Cartridge &cartridge, uint16 address, uint8_t value) {
+  cartridge.WritePRG(address, 0x80);
+
+  for (int i = 0; i < 5; i++) {
+    cartridge.WritePRG(address, (value >> i) & 1);
+  }
+}
+
+} // namespace
+
 TEST_CASE("Nesturbia_Mapper1_Valid", "[mapper]") {
   std::array<uint8_t, 0x20010> rom = {};
   rom[0] = 'N';
@@ -94,3 +109,55 @@ TEST_CASE("Nesturbia_Mapper1_Control", "[mapper]") {
   // TODO make other tests:
   // * Middle two internal registers
 }
+
+TEST_CASE("Nesturbia_Mapper1_ChrBanks", "[mapper]") {
+  // PRG-ROM: 2 * 16K, CHR-ROM: 8 * 8K, where each 4K page is filled with its number
+  std::vector<uint8_t> rom(16 + 0x8000 + 0x10000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+  rom[4] = 2;
+  rom[5] = 8;
+
+  // Mapper: 1
+  rom[6] |= 1U << 4;
+
+  for (size_t i = 0; i < 0x10000; i++) {
+    rom[16 + 0x8000 + i] = static_cast<uint8_t>(i >> 12);
+  }
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  // 8K mode: CHR0 selects both pages, ignoring its bottom bit
+  writeRegister(cartridge, 0x8000, 0x0c);
+  writeRegister(cartridge, 0xa000, 0x05);
+  writeRegister(cartridge, 0xc000, 0x0b);
+  ppu.UpdateChrPages();
+
+  CHECK(cartridge.ReadCHR(0x0000) == 4);
+  CHECK(ppu.read(0x0fff) == 4);
+  CHECK(ppu.read(0x1000) == 5);
+
+  // 4K mode: CHR0 and CHR1 select a page each
+  writeRegister(cartridge, 0x8000, 0x1c);
+  ppu.UpdateChrPages();
+
+  CHECK(ppu.read(0x0400) == 5);
+  CHECK(ppu.read(0x1c00) == 0x0b);
+
+  // Pages past the end of CHR-ROM wrap around
+  writeRegister(cartridge, 0xc000, 0x1e);
+  ppu.UpdateChrPages();
+
+  CHECK(ppu.read(0x1000) == 0x0e);
+  CHECK(cartridge.ReadCHR(0x1000) == 0x0e);
+
+  // CHR-ROM can't be written to
+  cartridge.WriteCHR(0x0000, 0xff);
+  CHECK(cartridge.ReadCHR(0x0000) == 5);
+}
@@ -0,0 +1,49 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+TEST_CASE("Nesturbia_Mapper11_Banks", "[mapper]") {
+  // PRG-ROM: 4 * 32K, CHR-ROM: 16 * 8K, where each bank is filled with its number
+  std::vector<uint8_t> rom(16 + 0x20000 + 0x20000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+  rom[4] = 8;
+  rom[5] = 16;
+
+  // Mapper: 11
+  rom[6] = 11U << 4;
+
+  for (size_t i = 0; i < 0x20000; i++) {
+    rom[16 + i] = static_cast<uint8_t>(i >> 15);
+    rom[16 + 0x20000 + i] = static_cast<uint8_t>(i >> 13);
+  }
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  CHECK(cartridge.ReadPRG(0x8000) == 0);
+  CHECK(ppu.read(0x0000) == 0);
+
+  // PRG-ROM bank in bits 0-1, CHR bank in bits 4-7
+  cartridge.WritePRG(0x8000, 0xd2);
+  ppu.UpdateChrPages();
+
+  CHECK(cartridge.ReadPRG(0x8000) == 2);
+  CHECK(cartridge.ReadPRG(0xffff) == 2);
+  CHECK(ppu.read(0x0000) == 13);
+  CHECK(ppu.read(0x1fff) == 13);
+
+  // CHR-ROM can't be written to
+  cartridge.WriteCHR(0x0000, 0xff);
+  CHECK(cartridge.ReadCHR(0x0000) == 13);
+}
@@ -0,0 +1,77 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/nesturbia.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a UxROM ROM with 8 * 16K of PRG-ROM (each bank is filled with its number) and 8K of
+// CHR-RAM
+std::vector<uint8_t> createRom() {
+  std::vector<uint8_t> rom(16 + 0x20000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 8 * 16K
+  rom[4] = 8;
+
+  // CHR-RAM: 8K
+  rom[5] = 0;
+
+  // Mapper: 2, vertical mirroring
+  rom[6] = (2U << 4) | 0x1;
+
+  for (size_t i = 0; i < 0x20000; i++) {
+    rom[16 + i] = static_cast<uint8_t>(i >> 14);
+  }
+
+  return rom;
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_Mapper2_PrgBanks", "[mapper]") {
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+  CHECK(cartridge.GetMirrorType() == Mapper::mirror_t::vertical);
+
+  CHECK(cartridge.ReadPRG(0x8000) == 0);
+  CHECK(cartridge.ReadPRG(0xc000) == 7);
+
+  cartridge.WritePRG(0x8000, 5);
+  CHECK(cartridge.ReadPRG(0xbfff) == 5);
+  CHECK(cartridge.ReadPRG(0xffff) == 7);
+
+  // Banks past the end of PRG-ROM wrap around
+  cartridge.WritePRG(0xf000, 10);
+  CHECK(cartridge.ReadPRG(0x8000) == 2);
+}
+
+TEST_CASE("Nesturbia_Mapper2_Emulator", "[mapper]") {
+  // Test that the CPU and the PPU see the banks directly
+  const auto rom = createRom();
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  emulator.cpuWriteCallback(0x8000, 3);
+  CHECK(emulator.cpuReadPages[0x80] != nullptr);
+  CHECK(emulator.cpuReadCallback(0x8000) == 3);
+  CHECK(emulator.cpuReadCallback(0xc000) == 7);
+
+  // CHR-RAM
+  CHECK(emulator.ppu.chrWritePages[7] != nullptr);
+  emulator.cpuWriteCallback(0x2006, 0x1f);
+  emulator.cpuWriteCallback(0x2006, 0xff);
+  emulator.cpuWriteCallback(0x2007, 0x42);
+  CHECK(emulator.ppu.read(0x1fff) == 0x42);
+}
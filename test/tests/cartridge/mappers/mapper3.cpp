@@ -0,0 +1,79 @@
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a CNROM ROM with 32K of PRG-ROM, where each 8K bank of CHR-ROM is filled with its number
+std::vector<uint8_t> createRom(uint8_t chrRom8KUnits) {
+  std::vector<uint8_t> rom(16 + 0x8000 + chrRom8KUnits * 0x2000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 2 * 16K
+  rom[4] = 2;
+
+  rom[5] = chrRom8KUnits;
+
+  // Mapper: 3
+  rom[6] |= 3U << 4;
+
+  for (size_t i = 0; i < chrRom8KUnits * 0x2000U; i++) {
+    rom[16 + 0x8000 + i] = static_cast<uint8_t>(i >> 13);
+  }
+
+  return rom;
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_Mapper3_ChrBanks", "[mapper]") {
+  const auto rom = createRom(4);
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  CHECK(cartridge.ReadCHR(0x0000) == 0);
+  CHECK(ppu.read(0x1fff) == 0);
+
+  for (uint8_t bank = 0; bank < 4; bank++) {
+    cartridge.WritePRG(0x8000, bank);
+    ppu.UpdateChrPages();
+
+    CHECK(cartridge.ReadCHR(0x0123) == bank);
+    CHECK(ppu.read(0x0123) == bank);
+    CHECK(ppu.read(0x1c00) == bank);
+  }
+
+  // CHR-ROM can't be written to
+  ppu.WriteRegister(0x2006, 0x00);
+  ppu.WriteRegister(0x2006, 0x10);
+  ppu.WriteRegister(0x2007, 0x55);
+  CHECK(ppu.read(0x0010) == 3);
+}
+
+TEST_CASE("Nesturbia_Mapper3_ChrBanksWrap", "[mapper]") {
+  // Banks past the end of CHR-ROM wrap around
+  const auto rom = createRom(2);
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  cartridge.WritePRG(0x8000, 3);
+  CHECK(cartridge.ReadCHR(0x0000) == 1);
+
+  // And CNROM always has CHR-ROM
+  const auto romWithoutChr = createRom(0);
+  CHECK_FALSE(cartridge.LoadRom(romWithoutChr.data(), romWithoutChr.size()));
+}
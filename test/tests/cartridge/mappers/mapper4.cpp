@@ -0,0 +1,349 @@
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/nesturbia.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates an MMC3 ROM with 16 * 8K of PRG-ROM and 64 * 1K of CHR-ROM, where each bank is filled
+// with its number
+std::vector<uint8_t> createRom() {
+  std::vector<uint8_t> rom(16 + 0x20000 + 0x10000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 8 * 16K
+  rom[4] = 8;
+
+  // CHR-ROM: 8 * 8K
+  rom[5] = 8;
+
+  // Mapper: 4
+  rom[6] |= 4U << 4;
+
+  for (size_t i = 0; i < 0x20000; i++) {
+    rom[16 + i] = static_cast<uint8_t>(i >> 13);
+  }
+
+  for (size_t i = 0; i < 0x10000; i++) {
+    rom[16 + 0x20000 + i] = static_cast<uint8_t>(i >> 10);
+  }
+
+  return rom;
+}
+
+// Creates an MMC3 ROM that counts the scanline counter's IRQs at $00
+// By default, the background comes from $0000 and the sprites from $1000, so the counter is clocked
+// once per rendered line
+std::vector<uint8_t> createIrqRom(uint8_t latch, uint8_t ppuCtrl = 0x08, uint8_t ppuMask = 0x18) {
+  std::vector<uint8_t> rom(16 + 0x8000 + 0x2000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 2 * 16K
+  rom[4] = 2;
+
+  // CHR-ROM: 1 * 8K
+  rom[5] = 1;
+
+  // Mapper: 4
+  rom[6] |= 4U << 4;
+
+  const std::array<uint8_t, 31> kProgram = {
+      0x78,                            // SEI
+      0xa9, 0x40, 0x8d, 0x17, 0x40,    // LDA #$40, STA $4017 (no APU frame IRQs)
+      0xa9, ppuCtrl, 0x8d, 0x00, 0x20, // LDA #ppuCtrl, STA $2000 (pattern tables)
+      0xa9, ppuMask, 0x8d, 0x01, 0x20, // LDA #ppuMask, STA $2001 (rendering)
+      0xa9, latch, 0x8d, 0x00, 0xc0,   // LDA #latch, STA $c000 (IRQ latch)
+      0x8d, 0x01, 0xc0,                // STA $c001 (IRQ reload)
+      0x8d, 0x01, 0xe0,                // STA $e001 (IRQ enable)
+      0x58,                            // CLI
+      0x4c, 0x1c, 0xe0,                // JMP $e01c
+  };
+
+  constexpr std::array<uint8_t, 9> kIrqHandler = {
+      0x8d, 0x00, 0xe0, // STA $e000 (IRQ disable)
+      0x8d, 0x01, 0xe0, // STA $e001 (IRQ enable)
+      0xe6, 0x00,       // INC $00
+      0x40,             // RTI
+  };
+
+  // The last 8K bank is always at $e000
+  for (size_t i = 0; i < kProgram.size(); i++) {
+    rom[16 + 0x6000 + i] = kProgram[i];
+  }
+
+  for (size_t i = 0; i < kIrqHandler.size(); i++) {
+    rom[16 + 0x6040 + i] = kIrqHandler[i];
+  }
+
+  // NMI vector: $e040 (unused), reset vector: $e000, IRQ vector: $e040
+  rom[16 + 0x7ffa] = 0x40;
+  rom[16 + 0x7ffb] = 0xe0;
+  rom[16 + 0x7ffc] = 0x00;
+  rom[16 + 0x7ffd] = 0xe0;
+  rom[16 + 0x7ffe] = 0x40;
+  rom[16 + 0x7fff] = 0xe0;
+
+  return rom;
+}
+
+void writeBank(Cartridge &cartridge, uint8_t bankSelect, uint8_t bank) {
+  cartridge.WritePRG(0x8000, bankSelect);
+  cartridge.WritePRG(0x8001, bank);
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_Mapper4_PrgBanks", "[mapper]") {
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  writeBank(cartridge, 6, 3);
+  writeBank(cartridge, 7, 5);
+
+  CHECK(cartridge.ReadPRG(0x8000) == 3);
+  CHECK(cartridge.ReadPRG(0xa000) == 5);
+  CHECK(cartridge.ReadPRG(0xc000) == 14);
+  CHECK(cartridge.ReadPRG(0xffff) == 15);
+
+  // PRG-ROM bank mode 1 swaps $8000 and $c000
+  cartridge.WritePRG(0x8000, 0x40);
+
+  CHECK(cartridge.ReadPRG(0x8000) == 14);
+  CHECK(cartridge.ReadPRG(0xa000) == 5);
+  CHECK(cartridge.ReadPRG(0xc000) == 3);
+  CHECK(cartridge.ReadPRG(0xe000) == 15);
+
+  // Banks past the end of PRG-ROM wrap around
+  writeBank(cartridge, 0x47, 0x13);
+  CHECK(cartridge.ReadPRG(0xa000) == 3);
+}
+
+TEST_CASE("Nesturbia_Mapper4_ChrBanks", "[mapper]") {
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  for (uint8_t i = 0; i < 6; i++) {
+    writeBank(cartridge, i, static_cast<uint8_t>(0x11 + i * 2));
+  }
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  // The 2K banks ignore their bottom bit
+  constexpr std::array<uint8_t, 8> kBanks = {0x10, 0x11, 0x12, 0x13, 0x15, 0x17, 0x19, 0x1b};
+  for (uint16_t i = 0; i < 8; i++) {
+    CHECK(ppu.read(i << 10) == kBanks[i]);
+    CHECK(cartridge.ReadCHR((i << 10) | 0x3ff) == kBanks[i]);
+  }
+
+  // CHR A12 inversion swaps the pattern tables
+  cartridge.WritePRG(0x8000, 0x80);
+  ppu.UpdateChrPages();
+
+  for (uint16_t i = 0; i < 8; i++) {
+    CHECK(ppu.read(i << 10) == kBanks[i ^ 4]);
+  }
+
+  // CHR-ROM can't be written to
+  cartridge.WriteCHR(0x0000, 0xff);
+  CHECK(cartridge.ReadCHR(0x0000) == kBanks[4]);
+}
+
+TEST_CASE("Nesturbia_Mapper4_MirroringAndPrgRam", "[mapper]") {
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  cartridge.WritePRG(0xa000, 0x01);
+  CHECK(cartridge.GetMirrorType() == Mapper::mirror_t::horizontal);
+
+  cartridge.WritePRG(0xa000, 0x00);
+  CHECK(cartridge.GetMirrorType() == Mapper::mirror_t::vertical);
+
+  cartridge.WritePRG(0x6000, 0x12);
+  CHECK(cartridge.ReadPRG(0x6000) == 0x12);
+
+  // Write-protected
+  cartridge.WritePRG(0xa001, 0xc0);
+  cartridge.WritePRG(0x6000, 0x34);
+  CHECK(cartridge.ReadPRG(0x6000) == 0x12);
+
+  // Disabled (reads are open bus)
+  cartridge.WritePRG(0xa001, 0x00);
+  cartridge.WritePRG(0x7000, 0x56);
+  CHECK(cartridge.ReadPRG(0x7000) == 0x70);
+
+  cartridge.WritePRG(0xa001, 0x80);
+  CHECK(cartridge.ReadPRG(0x7000) == 0x00);
+}
+
+TEST_CASE("Nesturbia_Mapper4_Irq", "[mapper]") {
+  // Test that the IRQ is raised on the right line, even though the PPU runs behind the CPU
+  constexpr uint8_t kLatch = 19;
+
+  const auto rom = createIrqRom(kLatch);
+  const auto renderer = GENERATE(Ppu::renderer_t::dot, Ppu::renderer_t::scanline);
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  emulator.ppu.renderer = renderer;
+
+  struct irq_t {
+    uint32_t cycles;
+    uint16_t scanline;
+  };
+
+  std::vector<irq_t> irqs;
+  emulator.ppu.irqCallback = [&] {
+    irqs.push_back({emulator.cpu.cycles, emulator.ppu.scanline});
+    emulator.cpu.IRQ(Nesturbia::cpu_t::irq_source_t::cartridge);
+  };
+
+  for (int frame = 0; frame < 10; frame++) {
+    emulator.RunFrame();
+  }
+
+  // The last IRQ may not have been taken by the end of the frame
+  REQUIRE(irqs.size() > 100);
+  CHECK(static_cast<size_t>(emulator.ram[0]) >= irqs.size() - 1);
+  CHECK(static_cast<size_t>(emulator.ram[0]) <= irqs.size());
+
+  for (size_t i = 1; i < irqs.size(); i++) {
+    // Every (latch + 1) rendered lines
+    const auto lines = (irqs[i].scanline + 262 - irqs[i - 1].scanline) % 262;
+    CHECK((lines == kLatch + 1 || (lines == kLatch + 1 + 21 && irqs[i].scanline < kLatch + 1)));
+
+    // On time: the CPU is at the same point of the line when each IRQ happens (within the 3 dots
+    // of a CPU cycle, plus the frame's odd dot)
+    if (lines == kLatch + 1) {
+      const auto cycles = irqs[i].cycles - irqs[i - 1].cycles;
+      CHECK(cycles * 3 >= lines * 341 - 3);
+      CHECK(cycles * 3 <= lines * 341 + 3);
+    }
+  }
+}
+
+TEST_CASE("Nesturbia_Mapper4_IrqWithoutA12Rises", "[mapper]") {
+  // Test that the counter isn't clocked when A12 doesn't rise: without rendering, or with the
+  // background and the sprites in the same pattern table
+  const auto registers = GENERATE(std::array<uint8_t, 2>{0x08, 0x00},
+                                  std::array<uint8_t, 2>{0x00, 0x18},
+                                  std::array<uint8_t, 2>{0x18, 0x18});
+  const auto renderer = GENERATE(Ppu::renderer_t::dot, Ppu::renderer_t::scanline);
+
+  const auto rom = createIrqRom(0, registers[0], registers[1]);
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  emulator.ppu.renderer = renderer;
+
+  uint32_t numIrqs = 0;
+  emulator.ppu.irqCallback = [&] {
+    ++numIrqs;
+    emulator.cpu.IRQ(Nesturbia::cpu_t::irq_source_t::cartridge);
+  };
+
+  for (int frame = 0; frame < 10; frame++) {
+    emulator.RunFrame();
+  }
+
+  CHECK(numIrqs == 0);
+  CHECK(static_cast<size_t>(emulator.ram[0]) == 0);
+}
+
+TEST_CASE("Nesturbia_Mapper4_IrqAcknowledge", "[mapper]") {
+  // Test that an IRQ that's acknowledged while interrupts are disabled is never taken
+  auto rom = createIrqRom(0);
+
+  // Rather than enabling interrupts right away, wait for VBLANK (when plenty of IRQs have been
+  // raised) and acknowledge the IRQ before that
+  constexpr std::array<uint8_t, 15> kWait = {
+      0x2c, 0x02, 0x20, // BIT $2002 (clear the VBLANK flag from power-up)
+      0x2c, 0x02, 0x20, // BIT $2002
+      0x10, 0xfb,       // BPL $e01e
+      0x8d, 0x00, 0xe0, // STA $e000 (IRQ disable and acknowledge)
+      0x58,             // CLI
+      0x4c, 0x27, 0xe0, // JMP $e027
+  };
+
+  for (size_t i = 0; i < kWait.size(); i++) {
+    rom[16 + 0x601b + i] = kWait[i];
+  }
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  uint32_t numIrqs = 0;
+  emulator.ppu.irqCallback = [&] {
+    ++numIrqs;
+    emulator.cpu.IRQ(Nesturbia::cpu_t::irq_source_t::cartridge);
+  };
+
+  emulator.RunFrame();
+  emulator.RunFrame();
+
+  CHECK(numIrqs > 0);
+  CHECK(!emulator.cpu.P.I);
+  CHECK(emulator.cpu.irq == 0);
+  CHECK(static_cast<size_t>(emulator.ram[0]) == 0);
+}
+
+TEST_CASE("Nesturbia_Mapper4_IrqEvent", "[mapper]") {
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  std::vector<std::array<uint16_t, 2>> irqs;
+
+  Ppu ppu(cartridge, [] {}, [&] { irqs.push_back({ppu.scanline, ppu.dot}); });
+  ppu.Power();
+  ppu.scanline = 261;
+  ppu.dot = 0;
+
+  cartridge.WritePRG(0xc000, 4);
+  cartridge.WritePRG(0xe001, 0);
+
+  // Nothing happens without rendering
+  CHECK(ppu.DotsUntilNextEvent() == 341 + 240 * 341 + 1);
+  ppu.Run(262 * 341);
+  CHECK(irqs.empty());
+
+  // Or with the background and the sprites in the same pattern table (this odd frame skips a dot)
+  ppu.WriteRegister(0x2001, 0x18);
+  CHECK(ppu.DotsUntilNextEvent() == 341 + 240 * 341);
+  ppu.Run(262 * 341);
+  CHECK(irqs.empty());
+
+  ppu.scanline = 261;
+  ppu.dot = 0;
+
+  // The counter is reloaded on the pre-render line, so the IRQ comes at the end of line 3
+  ppu.WriteRegister(0x2000, 0x08);
+  ppu.WriteRegister(0x2001, 0x18);
+  CHECK(ppu.DotsUntilNextEvent() == 341 + 3 * 341 + 260 + 1);
+
+  ppu.Run(ppu.DotsUntilNextEvent());
+  CHECK(irqs == std::vector<std::array<uint16_t, 2>>{{3, 260}});
+
+  // With the tables swapped, A12 rises when the next line's tiles are fetched instead
+  ppu.WriteRegister(0x2000, 0x10);
+  CHECK(ppu.DotsUntilNextEvent() == 4 * 341 + 63 + 1);
+}
@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+TEST_CASE("Nesturbia_Mapper66_Banks", "[mapper]") {
+  // PRG-ROM: 4 * 32K, CHR-ROM: 4 * 8K, where each bank is filled with its number
+  std::vector<uint8_t> rom(16 + 0x20000 + 0x8000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+  rom[4] = 8;
+  rom[5] = 4;
+
+  // Mapper: 66 (the upper nibble is in byte 7)
+  rom[6] = 0x2 << 4;
+  rom[7] = 0x40;
+
+  for (size_t i = 0; i < 0x20000; i++) {
+    rom[16 + i] = static_cast<uint8_t>(i >> 15);
+  }
+
+  for (size_t i = 0; i < 0x8000; i++) {
+    rom[16 + 0x20000 + i] = static_cast<uint8_t>(i >> 13);
+  }
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+  CHECK(cartridge.mapperNumber == 66);
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  // PRG-ROM bank in bits 4-5, CHR bank in bits 0-1
+  cartridge.WritePRG(0x8000, 0x31);
+  ppu.UpdateChrPages();
+
+  CHECK(cartridge.ReadPRG(0x8000) == 3);
+  CHECK(cartridge.ReadPRG(0xffff) == 3);
+  CHECK(ppu.read(0x0000) == 1);
+  CHECK(ppu.read(0x1fff) == 1);
+
+  cartridge.WritePRG(0x8000, 0x12);
+  ppu.UpdateChrPages();
+
+  CHECK(cartridge.ReadPRG(0xc000) == 1);
+  CHECK(ppu.read(0x0400) == 2);
+}
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates an AxROM ROM with 4 * 32K of PRG-ROM (each bank is filled with its number) and 8K of
+// CHR-RAM
+std::vector<uint8_t> createRom() {
+  std::vector<uint8_t> rom(16 + 0x20000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 8 * 16K
+  rom[4] = 8;
+
+  // CHR-RAM: 8K
+  rom[5] = 0;
+
+  // Mapper: 7
+  rom[6] = 7U << 4;
+
+  for (size_t i = 0; i < 0x20000; i++) {
+    rom[16 + i] = static_cast<uint8_t>(i >> 15);
+  }
+
+  return rom;
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_Mapper7_Banks", "[mapper]") {
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  CHECK(cartridge.ReadPRG(0x8000) == 0);
+  CHECK(cartridge.ReadPRG(0xffff) == 0);
+  CHECK(cartridge.GetMirrorType() == Mapper::mirror_t::oneScreenLower);
+
+  cartridge.WritePRG(0x8000, 0x12);
+  CHECK(cartridge.ReadPRG(0x8000) == 2);
+  CHECK(cartridge.ReadPRG(0xffff) == 2);
+  CHECK(cartridge.GetMirrorType() == Mapper::mirror_t::oneScreenHigher);
+
+  // Banks past the end of PRG-ROM wrap around
+  cartridge.WritePRG(0x8000, 0x06);
+  CHECK(cartridge.ReadPRG(0xc000) == 2);
+  CHECK(cartridge.GetMirrorType() == Mapper::mirror_t::oneScreenLower);
+
+  // Only a multiple of 32K of PRG-ROM fits
+  auto smallRom = rom;
+  smallRom[4] = 1;
+  CHECK_FALSE(cartridge.LoadRom(smallRom.data(), 16 + 0x4000));
+}
+
+TEST_CASE("Nesturbia_Mapper7_Nametables", "[mapper]") {
+  // Test that the PPU follows the one-screen mirroring
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  cartridge.WritePRG(0x8000, 0x10);
+  ppu.UpdateNametables();
+
+  for (uint16_t address = 0x2000; address < 0x3000; address += 0x400) {
+    CHECK(ppu.nametables[(address >> 10) & 0x3] == &ppu.vram[0x400]);
+  }
+}
@@ -18,17 +18,17 @@ TEST_CASE("Apu_Noise_Registers", "[apu]") {
 
   // $400c: bit 5 is 'length counter halt' boolean
   cpu.write(0x400c, 0x20);
-  CHECK(cpu.noiseChannel.length.halt == true);
+  CHECK(cpu.apu.noiseChannel.length.halt == true);
 
   cpu.write(0x400c, 0x00);
-  CHECK(cpu.noiseChannel.length.halt == false);
+  CHECK(cpu.apu.noiseChannel.length.halt == false);
 
   // $400e bit 7 is the 'mode' of the noise channel
   cpu.write(0x400e, 0x80);
-  CHECK(cpu.noiseChannel.mode == true);
+  CHECK(cpu.apu.noiseChannel.mode == true);
 
   cpu.write(0x400e, 0x00);
-  CHECK(cpu.noiseChannel.mode == false);
+  CHECK(cpu.apu.noiseChannel.mode == false);
 
   // TODO add more tests
 }
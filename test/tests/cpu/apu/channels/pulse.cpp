@@ -18,7 +18,7 @@ TEST_CASE("Apu_Pulse_Registers", "[apu]") {
 
   cpu.write(0x4000, 0xff);
 
-  CHECK(cpu.pulseChannels[0].duty == 0x3);
+  CHECK(cpu.apu.pulseChannels[0].duty == 0x3);
 
   // TODO add more tests
 }
@@ -18,15 +18,15 @@ TEST_CASE("cpu_FrameCounter", "[cpu]") {
 
   cpu.Power();
 
-  CHECK(!cpu.frameCounter.mode);
-  CHECK(cpu.frameCounter.shiftRegister == 0x7fff);
+  CHECK(!cpu.apu.frameCounter.mode);
+  CHECK(cpu.apu.frameCounter.shiftRegister == 0x7fff);
 
   uint32_t tickNum = 1;
 
   // Check that the first quarter frame occurs at the correct time
   // Run 100K iterations in case the condition never becomes true
   for (; tickNum < 100000; tickNum++) {
-    if (cpu.frameCounter.shiftRegister == 0x1061) {
+    if (cpu.apu.frameCounter.shiftRegister == 0x1061) {
       break;
     }
 
@@ -38,7 +38,7 @@ TEST_CASE("cpu_FrameCounter", "[cpu]") {
   // Check that the second quarter frame occurs at the correct time
   // Run 100K iterations in case the condition never becomes true
   for (; tickNum < 100000; tickNum++) {
-    if (cpu.frameCounter.shiftRegister == 0x3603) {
+    if (cpu.apu.frameCounter.shiftRegister == 0x3603) {
       break;
     }
 
@@ -50,7 +50,7 @@ TEST_CASE("cpu_FrameCounter", "[cpu]") {
   // Check that the third quarter frame occurs at the correct time
   // Run 100K iterations in case the condition never becomes true
   for (; tickNum < 100000; tickNum++) {
-    if (cpu.frameCounter.shiftRegister == 0x2cd3) {
+    if (cpu.apu.frameCounter.shiftRegister == 0x2cd3) {
       break;
     }
 
@@ -62,7 +62,7 @@ TEST_CASE("cpu_FrameCounter", "[cpu]") {
   // Check that the fourth quarter frame occurs at the correct time
   // Run 100K iterations in case the condition never becomes true
   for (; tickNum < 100000; tickNum++) {
-    if (cpu.frameCounter.shiftRegister == 0x0a1f) {
+    if (cpu.apu.frameCounter.shiftRegister == 0x0a1f) {
       break;
     }
 
@@ -78,5 +78,5 @@ TEST_CASE("cpu_FrameCounter", "[cpu]") {
   cpu.tick();
   cpu.tick();
 
-  CHECK(cpu.frameCounter.shiftRegister == 0x7fff);
+  CHECK(cpu.apu.frameCounter.shiftRegister == 0x7fff);
 }
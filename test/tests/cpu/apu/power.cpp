@@ -17,7 +17,7 @@ TEST_CASE("Apu_Power", "[apu]") {
 
   cpu.Power();
 
-  CHECK(cpu.frameCounter.shiftRegister == 0x7fff);
-  CHECK(cpu.frameCounter.interruptInhibit == false);
-  CHECK(cpu.frameCounter.mode == false);
+  CHECK(cpu.apu.frameCounter.shiftRegister == 0x7fff);
+  CHECK(cpu.apu.frameCounter.interruptInhibit == false);
+  CHECK(cpu.apu.frameCounter.mode == false);
 }
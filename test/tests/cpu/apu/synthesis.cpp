@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/apu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+void captureSamples(void *userData, const float *samples, const int16_t *, size_t numSamples) {
+  auto &capture = *reinterpret_cast<std::vector<float> *>(userData);
+  capture.insert(capture.end(), samples, samples + numSamples);
+}
+
+// Returns the last sample that's output while the DMC channel holds the given level
+float dmcLevel(Apu::synthesis_t synthesis, uint8 value) {
+  Apu apu;
+  apu.Power();
+  apu.synthesis = synthesis;
+
+  std::array<float, 64> samples;
+  std::vector<float> capture;
+
+  AudioOutput audioOutput;
+  audioOutput.samples = samples.data();
+  audioOutput.bufferSize = samples.size();
+  audioOutput.callback = captureSamples;
+  audioOutput.userData = &capture;
+
+  apu.SetAudioOutput(audioOutput, 44100);
+  apu.WriteRegister(0x4011, value);
+
+  for (int i = 0; i < 2000; i++) {
+    (void)apu.Tick();
+  }
+
+  apu.FlushAudio();
+  return capture.back();
+}
+
+} // namespace
+
+TEST_CASE("Apu_BlepSynthesis", "[apu]") {
+  // Test that a step in the output level is band-limited, and settles on the right level
+  Apu apu;
+  apu.Power();
+  apu.synthesis = Apu::synthesis_t::blep;
+
+  std::array<float, 64> samples;
+  std::vector<float> capture;
+
+  AudioOutput audioOutput;
+  audioOutput.samples = samples.data();
+  audioOutput.bufferSize = samples.size();
+  audioOutput.callback = captureSamples;
+  audioOutput.userData = &capture;
+
+  apu.SetAudioOutput(audioOutput, 44100);
+
+  // Silence
+  for (int i = 0; i < 1000; i++) {
+    (void)apu.Tick();
+  }
+
+  // Step the DMC's output level
+  apu.WriteRegister(0x4011, 100);
+
+  for (int i = 0; i < 2000; i++) {
+    (void)apu.Tick();
+  }
+
+  apu.FlushAudio();
+
+  REQUIRE(capture.size() > 40);
+
+  // The same level as the averaging mixer
+  const auto level = static_cast<float>(163.67 / (24329.0 / 100 + 100) / 4);
+  CHECK(capture.front() == 0.0F);
+  CHECK(std::abs(capture.back() - level) < 1e-6F);
+
+  // The step is band-limited, so it rings around both levels instead of jumping between them
+  CHECK(*std::min_element(capture.begin(), capture.end()) < -0.01F * level);
+  CHECK(*std::max_element(capture.begin(), capture.end()) > 1.01F * level);
+}
+
+TEST_CASE("Apu_Mixer", "[apu]") {
+  // Test the nonlinear mixer through the DMC channel
+  const auto synthesis = GENERATE(Apu::synthesis_t::average, Apu::synthesis_t::blep);
+
+  CHECK(dmcLevel(synthesis, 0) == 0.0F);
+
+  // TND output = 163.67 / (24329 / DMC + 100), scaled down by 4 for headroom
+  const auto level = dmcLevel(synthesis, 127);
+  CHECK(std::abs(level - static_cast<float>(163.67 / (24329.0 / 127 + 100) / 4)) < 1e-6F);
+
+  // Doubling the channel's output doesn't double the mixer's output
+  CHECK(dmcLevel(synthesis, 100) < 2 * dmcLevel(synthesis, 50));
+}
@@ -0,0 +1,173 @@
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM that plays a square wave on pulse channel 1, then loops forever
+test::nrom_t createSquareWaveRom() {
+  const std::vector<uint8_t> kProgram = {
+      0xa9, 0x01, 0x8d, 0x15, 0x40, // LDA #$01, STA $4015 (enable pulse 1)
+      0xa9, 0xbf, 0x8d, 0x00, 0x40, // LDA #$bf, STA $4000 (duty, constant volume 15)
+      0xa9, 0x80, 0x8d, 0x02, 0x40, // LDA #$80, STA $4002 (timer low)
+      0xa9, 0x02, 0x8d, 0x03, 0x40, // LDA #$02, STA $4003 (timer high, length)
+      0x4c, 0x14, 0x80,             // JMP $8014
+  };
+
+  return test::createNrom(kProgram);
+}
+
+struct audio_capture_t {
+  std::vector<size_t> blockSizes;
+  std::vector<float> samples;
+  std::vector<int16_t> int16Samples;
+};
+
+void captureAudio(void *userData, const float *samples, const int16_t *int16Samples,
+                  size_t numSamples) {
+  auto &capture = *reinterpret_cast<audio_capture_t *>(userData);
+
+  capture.blockSizes.push_back(numSamples);
+  capture.samples.insert(capture.samples.end(), samples, samples + numSamples);
+  if (int16Samples) {
+    capture.int16Samples.insert(capture.int16Samples.end(), int16Samples,
+                                int16Samples + numSamples);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_AudioOutput", "[integration]") {
+  const auto rom = createSquareWaveRom();
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  std::array<float, 300> samples;
+  std::array<int16_t, 300> int16Samples;
+  audio_capture_t capture;
+
+  AudioOutput audioOutput;
+  audioOutput.samples = samples.data();
+  audioOutput.int16Samples = int16Samples.data();
+  audioOutput.bufferSize = samples.size();
+  audioOutput.callback = captureAudio;
+  audioOutput.userData = &capture;
+
+  emulator.SetAudioOutput(audioOutput, 44100);
+
+  // The first frame after power is shorter than the others (the PPU starts on line 0, not 240)
+  emulator.RunFrame();
+  capture = {};
+
+  emulator.RunFrame();
+
+  // The samples are handed over whenever the buffer is full, and at the end of the frame
+  // There are ~735 samples per frame at 44.1 kHz
+  REQUIRE(capture.blockSizes.size() == 3);
+  CHECK(capture.blockSizes[0] == 300);
+  CHECK(capture.blockSizes[1] == 300);
+  CHECK(capture.blockSizes[2] > 100);
+  CHECK(capture.blockSizes[2] < 200);
+
+  // Make sure that the square wave is actually in there, and that the 16-bit samples match
+  REQUIRE(capture.int16Samples.size() == capture.samples.size());
+
+  bool hasSound = false;
+  for (size_t i = 0; i < capture.samples.size(); i++) {
+    hasSound = hasSound || capture.samples[i] != 0.0F;
+    CHECK(capture.int16Samples[i] == static_cast<int16_t>(capture.samples[i] * 32767.0F));
+  }
+
+  CHECK(hasSound);
+
+  // Without a buffer, nothing is output
+  emulator.SetAudioOutput({}, 44100);
+  capture.blockSizes.clear();
+
+  emulator.RunFrame();
+  CHECK(capture.blockSizes.empty());
+}
+
+TEST_CASE("Nesturbia_AudioOutputMultipleInstances", "[integration]") {
+  // Test that emulators running side by side don't share any mixer state
+  const auto rom = createSquareWaveRom();
+
+  std::array<Nesturbia, 3> emulators;
+  std::array<std::array<float, 256>, 3> buffers;
+  std::array<audio_capture_t, 3> captures;
+
+  for (size_t i = 0; i < emulators.size(); i++) {
+    REQUIRE(emulators[i].LoadRom(rom.data(), rom.size()));
+
+    AudioOutput audioOutput;
+    audioOutput.samples = buffers[i].data();
+    audioOutput.bufferSize = buffers[i].size();
+    audioOutput.callback = captureAudio;
+    audioOutput.userData = &captures[i];
+
+    emulators[i].SetAudioOutput(audioOutput, 44100);
+  }
+
+  // The last emulator runs by itself, the others are interleaved
+  for (int frame = 0; frame < 3; frame++) {
+    emulators[0].RunFrame();
+    emulators[1].RunFrame();
+  }
+
+  for (int frame = 0; frame < 3; frame++) {
+    emulators[2].RunFrame();
+  }
+
+  REQUIRE(!captures[2].samples.empty());
+  CHECK(captures[0].samples == captures[2].samples);
+  CHECK(captures[1].samples == captures[2].samples);
+}
+
+TEST_CASE("Nesturbia_AudioSampleRate", "[integration]") {
+  // Test that the sample rate can be nudged without interrupting the output
+  const auto rom = createSquareWaveRom();
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  std::array<float, 1024> samples;
+  audio_capture_t capture;
+
+  AudioOutput audioOutput;
+  audioOutput.samples = samples.data();
+  audioOutput.bufferSize = samples.size();
+  audioOutput.callback = captureAudio;
+  audioOutput.userData = &capture;
+
+  emulator.SetAudioOutput(audioOutput, 44100);
+  emulator.RunFrame();
+
+  // Nothing is handed over early
+  capture = {};
+  emulator.SetAudioSampleRate(44100 * 1.01);
+  CHECK(capture.blockSizes.empty());
+
+  // ~1% more samples over the next frames
+  for (int frame = 0; frame < 10; frame++) {
+    emulator.RunFrame();
+  }
+
+  CHECK(capture.samples.size() > 7400);
+  CHECK(capture.samples.size() < 7450);
+
+  capture = {};
+  emulator.SetAudioSampleRate(44100 * 0.99);
+  for (int frame = 0; frame < 10; frame++) {
+    emulator.RunFrame();
+  }
+
+  CHECK(capture.samples.size() > 7250);
+  CHECK(capture.samples.size() < 7300);
+}
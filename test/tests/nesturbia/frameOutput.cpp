@@ -0,0 +1,115 @@
+#include <array>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM that moves sprite 0 diagonally in its NMI handler, and counts how long it takes
+// for the sprite 0 hit to happen in its main loop
+// The other sprites are all on the same lines, so the sprite overflow flag is set as well
+test::nrom_t createRom() {
+  const std::vector<uint8_t> kProgram = {
+      0x78,                         // SEI
+      0xa2, 0x00,                   // LDX #$00
+      0xa9, 0x00,                   // LDA #$00
+      0x95, 0x00,                   // STA $00,X (clear the zero page and the sprites)
+      0x9d, 0x00, 0x02,             // STA $0200,X
+      0xe8,                         // INX
+      0xd0, 0xf8,                   // BNE $8005
+      0xa9, 0x1e, 0x8d, 0x01, 0x20, // LDA #$1e, STA $2001 (enable rendering)
+      0xa9, 0x80, 0x8d, 0x00, 0x20, // LDA #$80, STA $2000 (enable NMIs)
+      0x2c, 0x02, 0x20,             // BIT $2002
+      0x70, 0xfb,                   // BVS $8017 (wait for the sprite 0 hit to be cleared)
+      0xe6, 0x01,                   // INC $01
+      0x2c, 0x02, 0x20,             // BIT $2002
+      0x50, 0xf9,                   // BVC $801c (wait for the sprite 0 hit)
+      0xa5, 0x01, 0x85, 0x03,       // LDA $01, STA $03
+      0xad, 0x02, 0x20,             // LDA $2002
+      0x29, 0x20, 0x85, 0x04,       // AND #$20, STA $04 (sprite overflow)
+      0xa9, 0x00, 0x85, 0x01,       // LDA #$00, STA $01
+      0x4c, 0x17, 0x80,             // JMP $8017
+  };
+
+  const std::vector<uint8_t> kNmiHandler = {
+      0xe6, 0x00,                   // INC $00
+      0xa5, 0x00,                   // LDA $00
+      0x8d, 0x00, 0x02,             // STA $0200 (sprite 0's Y)
+      0x8d, 0x03, 0x02,             // STA $0203 (sprite 0's X)
+      0xa9, 0x02, 0x8d, 0x14, 0x40, // LDA #$02, STA $4014 (OAM DMA)
+      0x40,                         // RTI
+  };
+
+  return test::createNrom(kProgram, kNmiHandler, 11);
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_RunFrameWithoutOutput", "[integration]") {
+  // Test that frames without video and/or audio output run exactly the same way
+  const auto rom = createRom();
+  const auto renderer = GENERATE(Ppu::renderer_t::dot, Ppu::renderer_t::scanline);
+  const auto outputs = GENERATE(as<std::array<bool, 2>>{}, std::array<bool, 2>{false, false},
+                                std::array<bool, 2>{false, true}, std::array<bool, 2>{true, false});
+
+  FrameOutput output;
+  output.video = outputs[0];
+  output.audio = outputs[1];
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  emulator.ppu.renderer = renderer;
+
+  test::audio_capture_t audio;
+  test::captureAudio(emulator, audio);
+
+  Nesturbia otherEmulator;
+  REQUIRE(otherEmulator.LoadRom(rom.data(), rom.size()));
+  otherEmulator.ppu.renderer = renderer;
+
+  test::audio_capture_t otherAudio;
+  test::captureAudio(otherEmulator, otherAudio);
+
+  otherEmulator.ppu.pixels.fill(0x55);
+  const auto pixels = otherEmulator.ppu.pixels;
+
+  std::set<uint8_t> sprite0HitTimes;
+  for (int frame = 0; frame < 100; frame++) {
+    emulator.RunFrame();
+
+    otherAudio.samples.clear();
+    otherEmulator.RunFrame({}, {}, output);
+    CHECK(!otherAudio.samples.empty() == output.audio);
+
+    CHECK(otherEmulator.cpu.cycles == emulator.cpu.cycles);
+    CHECK(otherEmulator.ram[0] == emulator.ram[0]);
+    CHECK(otherEmulator.ram[1] == emulator.ram[1]);
+    CHECK(otherEmulator.ram[3] == emulator.ram[3]);
+    CHECK(otherEmulator.ram[4] == emulator.ram[4]);
+
+    if (output.video) {
+      CHECK(otherEmulator.ppu.pixels == emulator.ppu.pixels);
+    }
+
+    sprite0HitTimes.insert(emulator.ram[3]);
+  }
+
+  // Sprite 0 was hit at many different times, and the sprites overflowed
+  CHECK(sprite0HitTimes.size() > 10);
+  CHECK(emulator.ram[4] == 0x20);
+
+  if (!output.video) {
+    CHECK(otherEmulator.ppu.pixels == pixels);
+  }
+
+  // The next frame with output is drawn as usual
+  emulator.RunFrame();
+  otherEmulator.RunFrame();
+  CHECK(otherEmulator.ppu.pixels == emulator.ppu.pixels);
+}
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <vector>
 
 #include "catch2/catch_all.hpp"
 
@@ -16,3 +18,230 @@ TEST_CASE("Nesturbia_Memory", "[integration]") {
   CHECK(emulator.cpuReadCallback(0x17ff) == 0xaa);
   CHECK(emulator.cpuReadCallback(0x1fff) == 0xaa);
 }
+
+TEST_CASE("Nesturbia_MemoryWorkRam", "[integration]") {
+  Nesturbia emulator;
+
+  emulator.cpuWriteCallback(0x6000, 0x12);
+  emulator.cpuWriteCallback(0x7fff, 0x34);
+  CHECK(emulator.cartridge.workRam[0x0000] == 0x12);
+  CHECK(emulator.cartridge.workRam[0x1fff] == 0x34);
+  CHECK(emulator.cpuReadCallback(0x6000) == 0x12);
+  CHECK(emulator.cpuReadCallback(0x7fff) == 0x34);
+}
+
+TEST_CASE("Nesturbia_MemoryPrgBanks", "[integration]") {
+  // Test that PRG-ROM reads follow the mapper's bank switches
+  std::array<uint8_t, 16 + 4 * 0x4000> rom = {};
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 4 * 16K
+  rom[4] = 4;
+
+  // CHR-ROM: 0 * 8K
+  rom[5] = 0;
+
+  // Mapper: 1
+  rom[6] |= 1U << 4;
+
+  // Fill each 16K bank with its bank number
+  for (size_t i = 0; i < 4 * 0x4000; i++) {
+    rom[16 + i] = static_cast<uint8_t>(i >> 14);
+  }
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // Power-on: switchable bank 0 at $8000, last bank fixed at $c000
+  CHECK(emulator.cpuReadCallback(0x8000) == 0);
+  CHECK(emulator.cpuReadCallback(0xbfff) == 0);
+  CHECK(emulator.cpuReadCallback(0xc000) == 3);
+  CHECK(emulator.cpuReadCallback(0xffff) == 3);
+
+  // Switch bank 2 in at $8000 (MMC1 registers are written one bit at a time)
+  for (const uint8 value : {0, 1, 0, 0, 0}) {
+    emulator.cpuWriteCallback(0xe000, value);
+  }
+
+  CHECK(emulator.cpuReadCallback(0x8000) == 2);
+  CHECK(emulator.cpuReadCallback(0xbfff) == 2);
+  CHECK(emulator.cpuReadCallback(0xc000) == 3);
+  CHECK(emulator.cpuReadCallback(0xffff) == 3);
+}
+
+TEST_CASE("Nesturbia_MemoryNametables", "[integration]") {
+  // Test that nametable accesses follow the mapper's mirroring
+  std::array<uint8_t, 16 + 2 * 0x4000> rom = {};
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 2 * 16K
+  rom[4] = 2;
+
+  // CHR-ROM: 0 * 8K
+  rom[5] = 0;
+
+  // Mapper: 1
+  rom[6] |= 1U << 4;
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // Writes $2000-$2c00 (through PPUADDR/PPUDATA) with a different value each
+  const auto writeNametables = [&emulator] {
+    for (uint8_t nametable = 0; nametable < 4; nametable++) {
+      emulator.cpuWriteCallback(0x2006, 0x20 + nametable * 4);
+      emulator.cpuWriteCallback(0x2006, 0x00);
+      emulator.cpuWriteCallback(0x2007, 0x10 + nametable);
+    }
+  };
+
+  // Control register: mirroring (bits 0-1) = 2 (vertical), PRG-ROM bank mode = 3
+  for (const uint8 value : {0, 1, 1, 1, 0}) {
+    emulator.cpuWriteCallback(0x8000, value);
+  }
+
+  writeNametables();
+  CHECK(emulator.ppu.vram[0x000] == 0x12);
+  CHECK(emulator.ppu.vram[0x400] == 0x13);
+
+  // Mirroring = 3 (horizontal)
+  for (const uint8 value : {1, 1, 1, 1, 0}) {
+    emulator.cpuWriteCallback(0x8000, value);
+  }
+
+  writeNametables();
+  CHECK(emulator.ppu.vram[0x000] == 0x11);
+  CHECK(emulator.ppu.vram[0x400] == 0x13);
+
+  // Mirroring = 1 (one screen, upper bank)
+  for (const uint8 value : {1, 0, 1, 1, 0}) {
+    emulator.cpuWriteCallback(0x8000, value);
+  }
+
+  writeNametables();
+  CHECK(emulator.ppu.vram[0x000] == 0x11);
+  CHECK(emulator.ppu.vram[0x400] == 0x13);
+  CHECK(emulator.ppu.nametables[0] == emulator.ppu.nametables[3]);
+
+  // $3000-$3eff are mirrors of $2000-$2eff
+  emulator.cpuWriteCallback(0x2006, 0x30);
+  emulator.cpuWriteCallback(0x2006, 0x05);
+  emulator.cpuWriteCallback(0x2007, 0x77);
+  CHECK(emulator.ppu.vram[0x405] == 0x77);
+}
+
+TEST_CASE("Nesturbia_MemoryFourScreenNametables", "[integration]") {
+  // Test that each nametable has its own memory with four-screen VRAM, and that it's saved
+  std::array<uint8_t, 16 + 0x4000 + 0x2000> rom = {};
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 1 * 16K
+  rom[4] = 1;
+
+  // CHR-ROM: 1 * 8K
+  rom[5] = 1;
+
+  // Four-screen VRAM (and vertical mirroring, which is ignored)
+  rom[6] = 0x09;
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  CHECK(emulator.cartridge.GetMirrorType() == Mapper::mirror_t::fourScreen);
+  CHECK_FALSE(emulator.cartridge.isNesV2);
+
+  for (uint8_t nametable = 0; nametable < 4; nametable++) {
+    emulator.cpuWriteCallback(0x2006, 0x20 + nametable * 4);
+    emulator.cpuWriteCallback(0x2006, 0x01);
+    emulator.cpuWriteCallback(0x2007, 0x20 + nametable);
+  }
+
+  CHECK(emulator.ppu.vram[0x001] == 0x20);
+  CHECK(emulator.ppu.vram[0x401] == 0x21);
+  CHECK(emulator.cartridge.fourScreenVram[0x001] == 0x22);
+  CHECK(emulator.cartridge.fourScreenVram[0x401] == 0x23);
+
+  std::vector<uint8_t> state(emulator.StateSize());
+  REQUIRE(emulator.SaveState(state.data(), state.size()));
+
+  emulator.cartridge.fourScreenVram[0x401] = 0;
+  REQUIRE(emulator.LoadState(state.data(), state.size()));
+  CHECK(emulator.cartridge.fourScreenVram[0x401] == 0x23);
+}
+
+TEST_CASE("Nesturbia_MemoryFailedLoadRom", "[integration]") {
+  // Test that a ROM that fails to load leaves the previous one loaded
+  std::vector<uint8_t> rom(16 + 2 * 0x4000 + 0x2000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 2 * 16K (filled with NOPs, starting at $eaea)
+  rom[4] = 2;
+
+  // CHR-ROM: 1 * 8K
+  rom[5] = 1;
+
+  std::fill(rom.begin() + 16, rom.end(), 0xea);
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // NROM rejects 3 * 16K of PRG-ROM
+  std::vector<uint8_t> badRom(16 + 3 * 0x4000 + 0x2000);
+  std::copy(rom.begin(), rom.begin() + 16, badRom.begin());
+  badRom[4] = 3;
+
+  REQUIRE(!emulator.LoadRom(badRom.data(), badRom.size()));
+
+  CHECK(emulator.cpuReadCallback(0x8000) == 0xea);
+  CHECK(emulator.cpuReadCallback(0xffff) == 0xea);
+  CHECK(emulator.ppu.readChr(0x1fff) == 0xea);
+
+  emulator.RunFrame();
+  CHECK(emulator.cpu.PC >= 0x8000);
+}
+
+TEST_CASE("Nesturbia_MemoryFailedLoadRomHeader", "[integration]") {
+  // Test that the header of a ROM that fails to load isn't applied to the previous one
+  std::vector<uint8_t> rom(16 + 2 * 0x4000 + 0x2000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 2 * 16K
+  rom[4] = 2;
+
+  // CHR-ROM: 1 * 8K
+  rom[5] = 1;
+
+  // Vertical mirroring
+  rom[6] = 0x01;
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  const auto stateSize = emulator.StateSize();
+
+  // Battery-backed, four-screen VRAM and mapper 1, but one byte short
+  auto badRom = rom;
+  badRom[6] = 0x1b;
+  badRom.pop_back();
+
+  REQUIRE(!emulator.LoadRom(badRom.data(), badRom.size()));
+
+  CHECK(emulator.cartridge.GetMirrorType() == Mapper::mirror_t::vertical);
+  CHECK(emulator.cartridge.mapperNumber == 0);
+  CHECK(!emulator.cartridge.isBatteryBacked);
+  CHECK(emulator.StateSize() == stateSize);
+}
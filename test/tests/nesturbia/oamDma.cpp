@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM that fills page $02 with 0-255, then copies it to OAM (twice), and copies a page
+// of PRG-ROM to OAM
+test::nrom_t createRom() {
+  const std::vector<uint8_t> kProgram = {
+      0x78,                         // SEI
+      0xa2, 0x00,                   // LDX #$00
+      0x8a,                         // TXA
+      0x9d, 0x00, 0x02,             // STA $0200,X
+      0xe8,                         // INX
+      0xd0, 0xf9,                   // BNE $8003
+      0xa9, 0x10, 0x8d, 0x03, 0x20, // LDA #$10, STA $2003 (OAMADDR)
+      0xa9, 0x02, 0x8d, 0x14, 0x40, // LDA #$02, STA $4014 ($800f)
+      0xa9, 0x02, 0x8d, 0x14, 0x40, // LDA #$02, STA $4014 ($8014)
+      0xa5, 0x00,                   // LDA $00 (3 cycles, to change the parity)
+      0xa9, 0x80, 0x8d, 0x14, 0x40, // LDA #$80, STA $4014 ($801b)
+      0x4c, 0x20, 0x80,             // JMP $8020
+  };
+
+  return test::createNrom(kProgram);
+}
+
+void runUntil(Nesturbia &emulator, uint16_t address) {
+  for (int i = 0; i < 10000 && emulator.cpu.PC != address; i++) {
+    emulator.cpu.executeInstruction();
+  }
+
+  REQUIRE(emulator.cpu.PC == address);
+}
+
+// Runs LDA #$xx and STA $4014, and returns how many cycles the STA took
+uint32_t runDma(Nesturbia &emulator) {
+  emulator.cpu.executeInstruction();
+
+  const auto cycles = emulator.cpu.cycles;
+  emulator.cpu.executeInstruction();
+
+  return emulator.cpu.cycles - cycles;
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_OamDma", "[integration]") {
+  const auto rom = createRom();
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // Copying from RAM starts at OAMADDR, and wraps around
+  runUntil(emulator, 0x800f);
+  const auto firstDmaCycles = runDma(emulator);
+  CHECK((firstDmaCycles == 4 + 513 || firstDmaCycles == 4 + 514));
+
+  for (size_t i = 0; i < 0x100; i++) {
+    CHECK(emulator.ppu.oam[(0x10 + i) & 0xff] == i);
+  }
+
+  CHECK(emulator.ppu.oamaddr == 0x10);
+
+  // A DMA always ends on an odd cycle, so the next one (4 cycles later) starts on an odd cycle too,
+  // which takes an extra cycle to line up
+  CHECK(runDma(emulator) == 4 + 514);
+
+  // With an odd number of cycles in between, it doesn't
+  runUntil(emulator, 0x801b);
+  CHECK(runDma(emulator) == 4 + 513);
+
+  // Copying from PRG-ROM
+  for (size_t i = 0; i < 0x100; i++) {
+    CHECK(emulator.ppu.oam[(0x10 + i) & 0xff] == rom[test::kPrgRomOffset + i]);
+  }
+}
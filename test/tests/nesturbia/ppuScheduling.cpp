@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM whose program is all NOP instructions (2 cycles each)
+// Besides the reset vector ($8000), the vectors are NOP instructions as well ($eaea)
+test::nrom_t createNopRom() { return test::createNrom(std::vector<uint8_t>(0x4000, 0xea)); }
+
+} // namespace
+
+TEST_CASE("Nesturbia_PpuScheduling_CatchUp", "[integration]") {
+  Nesturbia emulator;
+
+  auto rom = createNopRom();
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // The PPU doesn't run while the CPU isn't accessing it
+  for (int i = 0; i < 10; i++) {
+    emulator.cpu.executeInstruction();
+  }
+
+  CHECK(emulator.ppu.scanline == 0);
+  CHECK(emulator.ppu.dot == 0);
+  CHECK(emulator.ppuPendingDots == 10 * 2 * 3);
+
+  // Accessing a PPU register catches it up first
+  static_cast<void>(emulator.cpuReadCallback(0x2002));
+
+  CHECK(emulator.ppu.scanline == 0);
+  CHECK(emulator.ppu.dot == 10 * 2 * 3);
+  CHECK(emulator.ppuPendingDots == 0);
+}
+
+TEST_CASE("Nesturbia_PpuScheduling_Events", "[integration]") {
+  Nesturbia emulator;
+
+  auto rom = createNopRom();
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // Enable NMIs (the NMI vector is $eaea, which is also a NOP instruction)
+  emulator.cpuWriteCallback(0x2000, 0x80);
+
+  // The end of the frame (line 240, dot 0) is reached even though the PPU is never accessed
+  emulator.RunFrame();
+
+  CHECK(emulator.ppu.scanline == 240);
+  CHECK(emulator.ppuPendingDots == 0);
+
+  // The NMI is triggered on line 241, dot 1
+  bool nmiTriggered = false;
+  for (int i = 0; i < 200 && !nmiTriggered; i++) {
+    emulator.cpu.executeInstruction();
+    nmiTriggered = emulator.cpu.nmi;
+  }
+
+  // The PPU was caught up to where the NMI occurred (it runs up to 2 more dots in that CPU tick)
+  CHECK(nmiTriggered);
+  CHECK(emulator.ppu.scanline == 241);
+  CHECK(emulator.ppu.dot >= 2);
+  CHECK(emulator.ppu.dot <= 4);
+}
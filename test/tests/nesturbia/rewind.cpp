@@ -0,0 +1,164 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM that scrolls the screen in its NMI handler, and adds the joypad's state to a
+// counter in RAM on every frame
+test::nrom_t createRom() {
+  const std::vector<uint8_t> kProgram = {
+      0x78,                         // SEI
+      0xa9, 0x1e, 0x8d, 0x01, 0x20, // LDA #$1e, STA $2001 (enable rendering)
+      0xa9, 0x80, 0x8d, 0x00, 0x20, // LDA #$80, STA $2000 (enable NMIs)
+      0x4c, 0x0b, 0x80,             // JMP $800b
+  };
+
+  const std::vector<uint8_t> kNmiHandler = {
+      0xa9, 0x01, 0x8d, 0x16, 0x40, // LDA #$01, STA $4016 (strobe the joypad)
+      0xa9, 0x00, 0x8d, 0x16, 0x40, // LDA #$00, STA $4016
+      0xad, 0x16, 0x40,             // LDA $4016 (A button)
+      0x29, 0x01,                   // AND #$01
+      0x65, 0x00,                   // ADC $00
+      0x85, 0x00,                   // STA $00
+      0x8d, 0x05, 0x20,             // STA $2005
+      0x40,                         // RTI
+  };
+
+  return test::createNrom(kProgram, kNmiHandler, 13);
+}
+
+struct frame_t {
+  decltype(Ppu::pixels) pixels;
+  uint32_t cycles;
+  uint8 counter;
+};
+
+frame_t currentFrame(const Nesturbia &emulator) {
+  return {emulator.ppu.pixels, emulator.cpu.cycles, emulator.ram[0]};
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_Rewind", "[integration]") {
+  const auto rom = createRom();
+
+  Nesturbia emulator;
+  emulator.EnableRewind(0x10000);
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  // Nothing to rewind to yet
+  CHECK_FALSE(emulator.RewindFrame());
+
+  std::vector<frame_t> frames;
+  for (int i = 0; i < 20; i++) {
+    Joypad::input_t input;
+    input.a = i % 3 != 0;
+
+    emulator.RunFrame(input);
+    frames.push_back(currentFrame(emulator));
+  }
+
+  // Step back one frame at a time, which produces the same frames as before (including the effects
+  // of the input)
+  for (size_t i = frames.size() - 1; i > 10; i--) {
+    REQUIRE(emulator.RewindFrame());
+
+    const auto frame = currentFrame(emulator);
+    CHECK(frame.pixels == frames[i - 1].pixels);
+    CHECK(frame.cycles == frames[i - 1].cycles);
+    CHECK(frame.counter == frames[i - 1].counter);
+  }
+
+  // Running from there with the same input gets back to the same frames
+  for (size_t i = 11; i < frames.size(); i++) {
+    Joypad::input_t input;
+    input.a = i % 3 != 0;
+
+    emulator.RunFrame(input);
+    CHECK(currentFrame(emulator).counter == frames[i].counter);
+    CHECK(currentFrame(emulator).cycles == frames[i].cycles);
+  }
+
+  // All the way back to the first frame
+  while (emulator.RewindFrame()) {
+  }
+
+  CHECK(currentFrame(emulator).cycles == frames[0].cycles);
+  CHECK(currentFrame(emulator).pixels == frames[0].pixels);
+}
+
+TEST_CASE("Nesturbia_RewindBufferFull", "[integration]") {
+  // Test that the oldest states are dropped when the buffer is full
+  const auto rom = createRom();
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  emulator.EnableRewind(0x400);
+
+  std::vector<uint32_t> cycles;
+  for (int i = 0; i < 100; i++) {
+    emulator.RunFrame();
+    cycles.push_back(emulator.cpu.cycles);
+  }
+
+  const auto numStates = emulator.rewindBuffer.NumStates();
+  CHECK(numStates > 2);
+  CHECK(numStates < 99);
+  CHECK(emulator.rewindBuffer.usedSize <= 0x400);
+
+  // Everything that's left can still be restored
+  size_t numRewoundFrames = 0;
+  while (emulator.RewindFrame()) {
+    ++numRewoundFrames;
+    CHECK(emulator.cpu.cycles == cycles[cycles.size() - 1 - numRewoundFrames]);
+  }
+
+  CHECK(numRewoundFrames == numStates - 1);
+  CHECK(numRewoundFrames < 99);
+}
+
+TEST_CASE("RewindBuffer_Deltas", "[rewind]") {
+  // Test that states are restored exactly, no matter how they differ from each other
+  constexpr size_t kStateSize = 1000;
+
+  RewindBuffer buffer;
+  buffer.Reset(0x10000, kStateSize);
+
+  std::vector<std::vector<uint8_t>> states;
+  std::vector<uint8_t> state(kStateSize);
+
+  uint32_t random = 1;
+  for (int i = 0; i < 50; i++) {
+    // Change a few bytes, a few runs of bytes, or everything
+    const auto numChanges = i % 10 == 0 ? kStateSize : static_cast<size_t>(i % 7);
+    for (size_t change = 0; change < numChanges; change++) {
+      random = random * 1103515245U + 12345U;
+      const auto offset = i % 10 == 0 ? change : (random >> 8) % kStateSize;
+      state[offset] = static_cast<uint8_t>(random >> 16);
+    }
+
+    buffer.Push(state.data());
+    states.push_back(state);
+  }
+
+  CHECK(buffer.NumStates() == states.size() - 1);
+
+  for (size_t i = states.size() - 1; i > 0; i--) {
+    REQUIRE(buffer.Pop(state.data()));
+    CHECK(state == states[i - 1]);
+  }
+
+  CHECK_FALSE(buffer.Pop(state.data()));
+
+  // Unchanged states only take up the space of their sizes
+  const auto usedSize = buffer.usedSize;
+  buffer.Push(state.data());
+  buffer.Push(state.data());
+  CHECK(buffer.usedSize - usedSize == 2 * 2 * sizeof(uint32_t));
+}
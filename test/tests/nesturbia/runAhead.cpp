@@ -0,0 +1,111 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM that adds the joypad's state to a counter in RAM on every frame, and scrolls the
+// screen by that counter, while playing a pulse wave
+test::nrom_t createRom() {
+  const std::vector<uint8_t> kProgram = {
+      0x78,                         // SEI
+      0xa9, 0x3f, 0x8d, 0x06, 0x20, // LDA #$3f, STA $2006
+      0xa9, 0x01, 0x8d, 0x06, 0x20, // LDA #$01, STA $2006 (background palette 0, color 1)
+      0xa9, 0x16, 0x8d, 0x07, 0x20, // LDA #$16, STA $2007
+      0xa9, 0x2a, 0x8d, 0x07, 0x20, // LDA #$2a, STA $2007
+      0xa9, 0x12, 0x8d, 0x07, 0x20, // LDA #$12, STA $2007
+      0xa9, 0x1e, 0x8d, 0x01, 0x20, // LDA #$1e, STA $2001 (enable rendering)
+      0xa9, 0x80, 0x8d, 0x00, 0x20, // LDA #$80, STA $2000 (enable NMIs)
+      0xa9, 0x01, 0x8d, 0x15, 0x40, // LDA #$01, STA $4015 (enable pulse 1)
+      0xa9, 0xbf, 0x8d, 0x00, 0x40, // LDA #$bf, STA $4000 (duty, constant volume 15)
+      0xa9, 0x02, 0x8d, 0x03, 0x40, // LDA #$02, STA $4003 (timer high, length)
+      0x4c, 0x33, 0x80,             // JMP $8033
+  };
+
+  const std::vector<uint8_t> kNmiHandler = {
+      0xa9, 0x01, 0x8d, 0x16, 0x40, // LDA #$01, STA $4016 (strobe the joypad)
+      0xa9, 0x00, 0x8d, 0x16, 0x40, // LDA #$00, STA $4016
+      0xad, 0x16, 0x40,             // LDA $4016 (A button)
+      0x29, 0x01,                   // AND #$01
+      0x65, 0x00,                   // ADC $00
+      0x85, 0x00,                   // STA $00
+      0x8d, 0x05, 0x20,             // STA $2005
+      0x8d, 0x02, 0x40,             // STA $4002
+      0x40,                         // RTI
+  };
+
+  return test::createNrom(kProgram, kNmiHandler, 11);
+}
+
+Joypad::input_t inputForFrame(int frame) {
+  Joypad::input_t input;
+  input.a = (frame / 4) % 2 == 0;
+  return input;
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_RunAhead", "[integration]") {
+  constexpr uint32_t kRunAheadFrames = 2;
+
+  const auto rom = createRom();
+  const auto renderer = GENERATE(Ppu::renderer_t::dot, Ppu::renderer_t::scanline);
+
+  Nesturbia emulator;
+  emulator.SetRunAhead(kRunAheadFrames);
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  emulator.ppu.renderer = renderer;
+
+  test::audio_capture_t audio;
+  test::captureAudio(emulator, audio);
+
+  // The same thing without running ahead, where the frames ahead are run by hand
+  Nesturbia expectedEmulator;
+  REQUIRE(expectedEmulator.LoadRom(rom.data(), rom.size()));
+  expectedEmulator.ppu.renderer = renderer;
+
+  test::audio_capture_t expectedAudio;
+  test::captureAudio(expectedEmulator, expectedAudio);
+
+  std::vector<uint8_t> state(expectedEmulator.StateSize());
+
+  for (int frame = 0; frame < 20; frame++) {
+    const auto input = inputForFrame(frame);
+
+    expectedAudio.samples.clear();
+    expectedEmulator.RunFrame(input);
+    const auto expectedSamples = expectedAudio.samples;
+    const auto expectedCycles = expectedEmulator.cpu.cycles;
+    const auto expectedCounter = expectedEmulator.ram[0];
+
+    REQUIRE(expectedEmulator.SaveState(state.data(), state.size()));
+    for (uint32_t i = 0; i < kRunAheadFrames; i++) {
+      expectedEmulator.RunFrame(input);
+    }
+
+    const auto expectedPixels = expectedEmulator.ppu.pixels;
+    REQUIRE(expectedEmulator.LoadState(state.data(), state.size()));
+
+    audio.samples.clear();
+    emulator.RunFrame(input);
+
+    // Only the real frame happened, and only its audio was output
+    CHECK(emulator.cpu.cycles == expectedCycles);
+    CHECK(emulator.ram[0] == expectedCounter);
+    CHECK(audio.samples == expectedSamples);
+
+    // But the frame that's shown is the one that's ahead
+    CHECK(emulator.ppu.pixels == expectedPixels);
+  }
+
+  // Running ahead can be turned off again
+  emulator.SetRunAhead(0);
+  expectedEmulator.RunFrame();
+  emulator.RunFrame();
+  CHECK(emulator.ppu.pixels == expectedEmulator.ppu.pixels);
+}
@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/nesturbia.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates a ROM that scrolls the screen and changes the pulse channel's period in its NMI handler,
+// while counting in RAM in its main loop
+test::nrom_t createRom(uint8_t chrSeed) {
+  const std::vector<uint8_t> kProgram = {
+      0x78,                         // SEI
+      0xa9, 0x1e, 0x8d, 0x01, 0x20, // LDA #$1e, STA $2001 (enable rendering)
+      0xa9, 0x80, 0x8d, 0x00, 0x20, // LDA #$80, STA $2000 (enable NMIs)
+      0xa9, 0x01, 0x8d, 0x15, 0x40, // LDA #$01, STA $4015 (enable pulse 1)
+      0xa9, 0xbf, 0x8d, 0x00, 0x40, // LDA #$bf, STA $4000 (duty, constant volume 15)
+      0xa9, 0x02, 0x8d, 0x03, 0x40, // LDA #$02, STA $4003 (timer high, length)
+      0xe6, 0x00,                   // INC $00
+      0x4c, 0x1a, 0x80,             // JMP $801a
+  };
+
+  const std::vector<uint8_t> kNmiHandler = {
+      0xe6, 0x01,       // INC $01
+      0xa5, 0x01,       // LDA $01
+      0x8d, 0x05, 0x20, // STA $2005
+      0x8d, 0x05, 0x20, // STA $2005
+      0x8d, 0x02, 0x40, // STA $4002
+      0x40,             // RTI
+  };
+
+  return test::createNrom(kProgram, kNmiHandler, chrSeed);
+}
+
+struct frame_t {
+  decltype(Ppu::pixels) pixels;
+  uint32_t cycles;
+  uint8 counter;
+  std::vector<float> samples;
+};
+
+frame_t runFrame(Nesturbia &emulator, test::audio_capture_t &audio) {
+  audio.samples.clear();
+  emulator.RunFrame();
+  return {emulator.ppu.pixels, emulator.cpu.cycles, emulator.ram[0], audio.samples};
+}
+
+} // namespace
+
+TEST_CASE("Nesturbia_SaveState", "[integration]") {
+  const auto rom = createRom(7);
+
+  Nesturbia emulator;
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+
+  test::audio_capture_t audio;
+  test::captureAudio(emulator, audio);
+
+  for (int i = 0; i < 10; i++) {
+    emulator.RunFrame();
+  }
+
+  std::vector<uint8_t> state(emulator.StateSize());
+  REQUIRE(emulator.SaveState(state.data(), state.size()));
+
+  std::vector<frame_t> frames;
+  for (int i = 0; i < 5; i++) {
+    frames.push_back(runFrame(emulator, audio));
+  }
+
+  // Loading the state rewinds the emulator, and it runs exactly the same frames again
+  REQUIRE(emulator.LoadState(state.data(), state.size()));
+
+  for (const auto &frame : frames) {
+    const auto replayedFrame = runFrame(emulator, audio);
+    CHECK(replayedFrame.pixels == frame.pixels);
+    CHECK(replayedFrame.cycles == frame.cycles);
+    CHECK(replayedFrame.counter == frame.counter);
+    CHECK(replayedFrame.samples == frame.samples);
+  }
+
+  // The same goes for a different emulator with the same ROM loaded
+  Nesturbia otherEmulator;
+  REQUIRE(otherEmulator.LoadRom(rom.data(), rom.size()));
+  REQUIRE(otherEmulator.LoadState(state.data(), state.size()));
+
+  test::audio_capture_t otherAudio;
+  test::captureAudio(otherEmulator, otherAudio);
+
+  const auto otherFrame = runFrame(otherEmulator, otherAudio);
+  CHECK(otherFrame.pixels == frames[0].pixels);
+  CHECK(otherFrame.cycles == frames[0].cycles);
+  CHECK(otherFrame.samples == frames[0].samples);
+}
+
+TEST_CASE("Nesturbia_SaveStateInvalid", "[integration]") {
+  const auto rom = createRom(7);
+
+  Nesturbia emulator;
+
+  // Nothing to save without a ROM
+  std::vector<uint8_t> state(0x10000);
+  CHECK_FALSE(emulator.SaveState(state.data(), state.size()));
+
+  REQUIRE(emulator.LoadRom(rom.data(), rom.size()));
+  emulator.RunFrame();
+
+  // The buffer is too small
+  state.resize(emulator.StateSize() - 1);
+  CHECK_FALSE(emulator.SaveState(state.data(), state.size()));
+
+  state.resize(emulator.StateSize());
+  REQUIRE(emulator.SaveState(state.data(), state.size()));
+
+  const auto cycles = emulator.cpu.cycles;
+
+  // The wrong size
+  state.push_back(0);
+  CHECK_FALSE(emulator.LoadState(state.data(), state.size()));
+  state.pop_back();
+
+  // The wrong version
+  auto badState = state;
+  badState[4] ^= 0xff;
+  CHECK_FALSE(emulator.LoadState(badState.data(), badState.size()));
+
+  // A different ROM
+  const auto otherRom = createRom(3);
+
+  Nesturbia otherEmulator;
+  REQUIRE(otherEmulator.LoadRom(otherRom.data(), otherRom.size()));
+  CHECK_FALSE(otherEmulator.LoadState(state.data(), state.size()));
+
+  // Nothing was loaded
+  CHECK(emulator.cpu.cycles == cycles);
+}
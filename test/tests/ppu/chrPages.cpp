@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// A mapper with two 8K banks of CHR-ROM (filled with 1 and 2), which records the PPU's CHR
+// accesses, and switches to the second bank once tile $fd of the left pattern table is fetched
+// (like MMC2's latches)
+struct ObservingMapper : public Mapper {
+  std::array<uint8, 0x4000> chrRom;
+  std::vector<uint16_t> observedAddresses;
+
+  ObservingMapper() {
+    std::fill(chrRom.begin(), chrRom.begin() + 0x2000, 1);
+    std::fill(chrRom.begin() + 0x2000, chrRom.end(), 2);
+    mapChr(0x0000, 0x2000, chrRom.data(), false);
+    observesPpuAddress = true;
+  }
+
+  [[nodiscard]] mirror_t GetMirrorType() const override { return mirror_t::horizontal; }
+
+  uint8 ReadPRG(uint16) override { return 0; }
+  void WritePRG(uint16, uint8) override {}
+
+  uint8 ReadCHR(uint16 address) override { return chrBanks[address >> 10][address & 0x3ff]; }
+  void WriteCHR(uint16, uint8) override {}
+
+  bool ObservePpuAddress(uint16 address) override {
+    observedAddresses.push_back(address);
+    if ((address & 0x1ff0) != 0x0fd0) {
+      return false;
+    }
+
+    mapChr(0x0000, 0x2000, chrRom.data() + 0x2000, false);
+    return true;
+  }
+};
+
+} // namespace
+
+TEST_CASE("Ppu_ChrAddressObserver", "[ppu]") {
+  Cartridge cartridge;
+  cartridge.mapper = std::make_unique<ObservingMapper>();
+  auto &mapper = *static_cast<ObservingMapper *>(cartridge.mapper.get());
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  CHECK(ppu.read(0x0010) == 1);
+  CHECK(mapper.observedAddresses == std::vector<uint16_t>{0x0010});
+
+  // The bank is switched after the fetch that triggers it
+  CHECK(ppu.read(0x0fd8) == 1);
+  CHECK(ppu.read(0x0010) == 2);
+
+  // Decoding tiles doesn't count as fetching them
+  mapper.observedAddresses.clear();
+  CHECK(ppu.decodedTileRow(0x0012, false) == std::array<uint8_t, 8>{0, 0, 0, 0, 0, 0, 3, 0});
+  CHECK(mapper.observedAddresses.empty());
+}
+
+TEST_CASE("Ppu_ChrAddressObserverRenderers", "[ppu]") {
+  // Test that the mapper sees the same fetches with either renderer (the scanline renderer falls
+  // back to the dot one)
+  std::array<std::vector<uint16_t>, 2> observedAddresses;
+
+  for (size_t i = 0; i < observedAddresses.size(); i++) {
+    Cartridge cartridge;
+    cartridge.mapper = std::make_unique<ObservingMapper>();
+
+    Ppu ppu(cartridge, [] {});
+    ppu.Power();
+    ppu.renderer = i == 0 ? Ppu::renderer_t::dot : Ppu::renderer_t::scanline;
+
+    // Background from the right pattern table, sprites from the left one
+    ppu.WriteRegister(0x2000, 0x10);
+    ppu.WriteRegister(0x2001, 0x18);
+    ppu.Run(262 * 341);
+
+    const auto &mapper = *static_cast<ObservingMapper *>(cartridge.mapper.get());
+    observedAddresses[i] = mapper.observedAddresses;
+  }
+
+  CHECK(observedAddresses[0].size() > 240 * 64);
+  CHECK(observedAddresses[1] == observedAddresses[0]);
+}
@@ -0,0 +1,103 @@
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/palette.hpp"
+using namespace nesturbia;
+
+TEST_CASE("Palette_Emphasis", "[ppu]") {
+  const Palette palette;
+
+  // Without emphasis, these are the plain colors
+  CHECK(palette.colors[0x00] == 0x545454);
+  CHECK(palette.colors[0x30] == 0xeceeec);
+
+  // Each emphasis bit darkens the other components
+  const auto white = palette.colors[0x30];
+  const auto red = palette.colors[0x30 | 0x40];
+  const auto green = palette.colors[0x30 | 0x80];
+  const auto blue = palette.colors[0x30 | 0x100];
+
+  CHECK((red >> 16) == (white >> 16));
+  CHECK(((red >> 8) & 0xff) < ((white >> 8) & 0xff));
+  CHECK((red & 0xff) < (white & 0xff));
+
+  CHECK(((green >> 8) & 0xff) == ((white >> 8) & 0xff));
+  CHECK((green >> 16) < (white >> 16));
+
+  CHECK((blue & 0xff) == (white & 0xff));
+  CHECK((blue >> 16) < (white >> 16));
+
+  // All of them darken everything
+  const auto all = palette.colors[0x30 | 0x1c0];
+  CHECK((all >> 16) < (red >> 16));
+  CHECK(((all >> 8) & 0xff) < ((green >> 8) & 0xff));
+  CHECK((all & 0xff) < (blue & 0xff));
+
+  // Black stays black
+  CHECK(palette.colors[0x0f | 0x1c0] == 0);
+}
+
+TEST_CASE("Palette_Convert", "[ppu]") {
+  Palette palette;
+  palette.colors[0x01] = 0x123456;
+  palette.colors[0x41] = 0xabcdef;
+
+  const std::array<uint16_t, 2> indexes = {0x01, 0x41};
+
+  std::array<uint8_t, 6> rgb = {};
+  palette.Convert(indexes.data(), indexes.size(), Palette::format_t::rgb, rgb.data());
+  CHECK(rgb == std::array<uint8_t, 6>{0x12, 0x34, 0x56, 0xab, 0xcd, 0xef});
+
+  std::array<uint8_t, 8> rgba = {};
+  palette.Convert(indexes.data(), indexes.size(), Palette::format_t::rgba, rgba.data());
+  CHECK(rgba == std::array<uint8_t, 8>{0x12, 0x34, 0x56, 0xff, 0xab, 0xcd, 0xef, 0xff});
+
+  std::array<uint8_t, 8> bgra = {};
+  palette.Convert(indexes.data(), indexes.size(), Palette::format_t::bgra, bgra.data());
+  CHECK(bgra == std::array<uint8_t, 8>{0x56, 0x34, 0x12, 0xff, 0xef, 0xcd, 0xab, 0xff});
+}
+
+TEST_CASE("Palette_ConvertFrame", "[ppu]") {
+  // Test that every instruction set and scale produces the same pixels as Convert()
+  // The width isn't a multiple of the vector sizes, so the leftover pixels are converted too
+  constexpr size_t kWidth = 27;
+  constexpr size_t kHeight = 5;
+
+  Palette palette;
+  const auto format = GENERATE(Palette::format_t::rgba, Palette::format_t::bgra);
+  const auto scale = GENERATE(1U, 2U, 3U, 4U);
+
+  // Indexes above 511 are masked, like in Convert()
+  std::vector<uint16_t> indexes(kWidth * kHeight);
+  for (size_t i = 0; i < indexes.size(); i++) {
+    indexes[i] = static_cast<uint16_t>(i * 37 + (i % 3 == 0 ? 0x200 : 0));
+  }
+
+  std::vector<uint32_t> converted(indexes.size());
+  palette.Convert(indexes.data(), indexes.size(), format,
+                  reinterpret_cast<uint8_t *>(converted.data()));
+
+  std::vector<uint32_t> expected;
+  for (size_t y = 0; y < kHeight * scale; y++) {
+    for (size_t x = 0; x < kWidth * scale; x++) {
+      expected.push_back(converted[(y / scale) * kWidth + x / scale]);
+    }
+  }
+
+  const auto best = static_cast<int>(Palette::BestInstructionSet());
+  for (int instructionSet = 0; instructionSet <= best; instructionSet++) {
+    palette.instructionSet = static_cast<Palette::instruction_set_t>(instructionSet);
+
+    std::vector<uint32_t> output(expected.size() + 1, 0x55555555);
+    palette.ConvertFrame(indexes.data(), kWidth, kHeight, format, scale, output.data());
+
+    // Nothing is written past the end
+    CHECK(output.back() == 0x55555555);
+    output.pop_back();
+
+    CHECK(output == expected);
+  }
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "catch2/catch_all.hpp"
+
+#include "helpers.hpp"
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+constexpr auto kDotsPerFrame = 262U * 341U;
+constexpr auto kScreenPixels = Ppu::kScreenWidth * Ppu::kScreenHeight;
+
+// Simple deterministic pseudo-random numbers so that both PPUs get the same data
+struct random_t {
+  uint32_t state;
+
+  uint8_t Next() {
+    state = state * 1103515245U + 12345U;
+    return static_cast<uint8_t>(state >> 16);
+  }
+};
+
+// Creates an NROM ROM with pseudo-random CHR-ROM
+test::nrom_t createRom() {
+  auto rom = test::createNrom({});
+
+  // Vertical mirroring
+  rom[6] = 0x01;
+
+  random_t random{1};
+  for (size_t i = 0; i < 0x2000; i++) {
+    rom[test::kChrRomOffset + i] = random.Next();
+  }
+
+  return rom;
+}
+
+void setUp(Ppu &ppu, Ppu::renderer_t renderer, uint8 ctrl, uint8 mask) {
+  ppu.Power();
+  ppu.renderer = renderer;
+
+  random_t random{2};
+  for (auto &value : ppu.vram) {
+    value = random.Next();
+  }
+
+  for (auto &value : ppu.paletteRam) {
+    value = random.Next() & 0x3f;
+  }
+
+  for (auto &value : ppu.oam) {
+    value = random.Next();
+  }
+
+  // Put sprite 0 somewhere that's guaranteed to be visible
+  ppu.oam[0] = 100;
+  ppu.oam[3] = 60;
+
+  ppu.renderData = {};
+  ppu.oamPrimary = {};
+  ppu.oamSecondary = {};
+
+  ppu.WriteRegister(0x2000, ctrl);
+  ppu.WriteRegister(0x2001, mask);
+  ppu.WriteRegister(0x2005, 0x2b);
+  ppu.WriteRegister(0x2005, 0x17);
+}
+
+void checkSame(const Ppu &dotPpu, const Ppu &scanlinePpu) {
+  CHECK(dotPpu.pixels == scanlinePpu.pixels);
+  CHECK(dotPpu.scanline == scanlinePpu.scanline);
+  CHECK(dotPpu.dot == scanlinePpu.dot);
+  CHECK(dotPpu.vramAddr.value == scanlinePpu.vramAddr.value);
+  CHECK(static_cast<unsigned>(dotPpu.status) == static_cast<unsigned>(scanlinePpu.status));
+}
+
+} // namespace
+
+TEST_CASE("Ppu_ScanlineRenderer", "[ppu]") {
+  // Test that the scanline renderer produces the same output as the dot renderer
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu dotPpu(cartridge, [] {});
+  Ppu scanlinePpu(cartridge, [] {});
+
+  // PPUCTRL: 8x8 and 8x16 sprites, both pattern tables
+  // PPUMASK: everything, only the background, only sprites, leftmost 8 pixels hidden, nothing
+  const auto ctrl = GENERATE(as<uint8_t>{}, 0x00, 0x08, 0x10, 0x20, 0x31);
+  const auto mask = GENERATE(as<uint8_t>{}, 0x1e, 0x0a, 0x14, 0x18, 0x00);
+
+  setUp(dotPpu, Ppu::renderer_t::dot, ctrl, mask);
+  setUp(scanlinePpu, Ppu::renderer_t::scanline, ctrl, mask);
+
+  for (int frame = 0; frame < 3; frame++) {
+    CHECK(dotPpu.Run(kDotsPerFrame) == scanlinePpu.Run(kDotsPerFrame));
+    checkSame(dotPpu, scanlinePpu);
+
+    // Move the sprites and the scroll position around between frames
+    for (size_t i = 3; i < dotPpu.oam.size(); i += 4) {
+      dotPpu.oam[i] += 3;
+      scanlinePpu.oam[i] += 3;
+    }
+
+    dotPpu.WriteRegister(0x2005, frame * 5);
+    dotPpu.WriteRegister(0x2005, frame * 7);
+    scanlinePpu.WriteRegister(0x2005, frame * 5);
+    scanlinePpu.WriteRegister(0x2005, frame * 7);
+  }
+}
+
+TEST_CASE("Ppu_ScanlineRendererMidLineWrites", "[ppu]") {
+  // Test that the scanline renderer falls back to the dot renderer when registers are written in
+  // the middle of a line
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu dotPpu(cartridge, [] {});
+  Ppu scanlinePpu(cartridge, [] {});
+
+  setUp(dotPpu, Ppu::renderer_t::dot, 0x00, 0x1e);
+  setUp(scanlinePpu, Ppu::renderer_t::scanline, 0x00, 0x1e);
+
+  // Run in uneven steps so that some lines are split and others aren't
+  uint8 step = 0;
+  for (uint32_t dots = 0; dots < 2 * kDotsPerFrame; step++) {
+    const auto stepDots = step % 4 == 0 ? 113U : 700U;
+
+    CHECK(dotPpu.Run(stepDots) == scanlinePpu.Run(stepDots));
+    dots += stepDots;
+
+    // Change the scroll position + PPUMASK
+    dotPpu.WriteRegister(0x2005, step);
+    dotPpu.WriteRegister(0x2001, step.bit(3) ? 0x1e : 0x18);
+    scanlinePpu.WriteRegister(0x2005, step);
+    scanlinePpu.WriteRegister(0x2001, step.bit(3) ? 0x1e : 0x18);
+  }
+
+  checkSame(dotPpu, scanlinePpu);
+}
+
+TEST_CASE("Ppu_NoOutput", "[ppu]") {
+  // Test that a PPU without any output doesn't touch the pixels, but still sets the sprite 0 hit
+  // and sprite overflow flags at exactly the same time
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  Ppu noOutputPpu(cartridge, [] {});
+
+  const auto renderer = GENERATE(Ppu::renderer_t::dot, Ppu::renderer_t::scanline);
+  const auto ctrl = GENERATE(as<uint8_t>{}, 0x00, 0x20);
+  const auto mask = GENERATE(as<uint8_t>{}, 0x1e, 0x18, 0x14);
+
+  setUp(ppu, renderer, ctrl, mask);
+  setUp(noOutputPpu, renderer, ctrl, mask);
+
+  noOutputPpu.isOutputEnabled = false;
+  noOutputPpu.pixels.fill(0x55);
+  const auto pixels = noOutputPpu.pixels;
+
+  // Mostly whole lines at a time (for the scanline renderer), with some lines split in two
+  bool isSprite0Hit = false;
+  uint8 step = 0;
+  for (uint32_t dots = 0; dots < 3 * kDotsPerFrame; step++) {
+    const auto stepDots = step % 8 == 0 ? 7U : (step % 8 == 1 ? 334U : 341U);
+
+    CHECK(ppu.Run(stepDots) == noOutputPpu.Run(stepDots));
+    dots += stepDots;
+
+    CHECK(static_cast<unsigned>(ppu.status) == static_cast<unsigned>(noOutputPpu.status));
+    CHECK(ppu.vramAddr.value == noOutputPpu.vramAddr.value);
+    isSprite0Hit |= ppu.status.sprite0Hit;
+
+    if (step % 64 == 0) {
+      // Move sprite 0 around
+      ppu.oam[0] += 5;
+      ppu.oam[3] += 9;
+      noOutputPpu.oam[0] += 5;
+      noOutputPpu.oam[3] += 9;
+    }
+  }
+
+  // Sprite 0 hits need both the background and sprites
+  CHECK(isSprite0Hit == (mask == 0x1e || mask == 0x18));
+  CHECK(noOutputPpu.pixels == pixels);
+
+  // Turning the output back on draws the next frame as usual
+  noOutputPpu.isOutputEnabled = true;
+  CHECK(ppu.Run(kDotsPerFrame) == noOutputPpu.Run(kDotsPerFrame));
+  CHECK(ppu.pixels == noOutputPpu.pixels);
+}
+
+TEST_CASE("Ppu_IndexedPixels", "[ppu]") {
+  // Test that converting the palette indexes gives the same colors as drawing the RGB pixels
+  const auto rom = createRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  Ppu indexedPpu(cartridge, [] {});
+
+  // PPUMASK: everything, plus grayscale, plus each emphasis bit
+  const auto renderer = GENERATE(Ppu::renderer_t::dot, Ppu::renderer_t::scanline);
+  const auto mask = GENERATE(as<uint8_t>{}, 0x1e, 0x1f, 0x3e, 0x5e, 0x9e, 0xff);
+
+  setUp(ppu, renderer, 0x00, mask);
+  setUp(indexedPpu, renderer, 0x00, mask);
+  indexedPpu.pixelFormat = Ppu::pixel_format_t::indexed;
+
+  CHECK(ppu.Run(kDotsPerFrame) == indexedPpu.Run(kDotsPerFrame));
+  CHECK(static_cast<unsigned>(ppu.status) == static_cast<unsigned>(indexedPpu.status));
+
+  std::array<uint8_t, kScreenPixels * 3> pixels;
+  indexedPpu.palette.Convert(indexedPpu.indexedPixels.data(), kScreenPixels,
+                             Palette::format_t::rgb, pixels.data());
+
+  CHECK(std::equal(pixels.begin(), pixels.end(), ppu.pixels.begin()));
+
+  // Grayscale colors only have one of 4 brightnesses, and the emphasis bits are kept
+  const auto &indexes = indexedPpu.indexedPixels;
+  CHECK(std::all_of(indexes.begin(), indexes.end(), [mask](uint16_t index) {
+    return ((mask & 0x01) == 0 || (index & 0x0f) == 0) && (index >> 6) == (mask >> 5);
+  }));
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "nesturbia/cartridge.hpp"
+#include "nesturbia/ppu.hpp"
+using namespace nesturbia;
+
+namespace {
+
+// Creates an NROM ROM with 8K of CHR-RAM
+std::array<uint8_t, 16 + 0x4000> createChrRamRom() {
+  std::array<uint8_t, 16 + 0x4000> rom = {};
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 1 * 16K
+  rom[4] = 1;
+
+  // CHR-RAM: 8K
+  rom[5] = 0;
+
+  return rom;
+}
+
+// Creates a CNROM ROM with 2 * 8K of CHR-ROM: every byte of bank 0 is $00, and of bank 1 is $ff
+std::vector<uint8_t> createChrRomRom() {
+  std::vector<uint8_t> rom(16 + 0x4000 + 0x4000);
+  rom[0] = 'N';
+  rom[1] = 'E';
+  rom[2] = 'S';
+  rom[3] = 0x1a;
+
+  // PRG-ROM: 1 * 16K
+  rom[4] = 1;
+
+  // CHR-ROM: 2 * 8K
+  rom[5] = 2;
+
+  // Mapper 3
+  rom[6] = 3U << 4;
+
+  std::fill(rom.begin() + 16 + 0x4000 + 0x2000, rom.end(), 0xff);
+
+  return rom;
+}
+
+void writeChr(Ppu &ppu, uint16 address, uint8 value) {
+  ppu.WriteRegister(0x2006, address >> 8);
+  ppu.WriteRegister(0x2006, address & 0xff);
+  ppu.WriteRegister(0x2007, value);
+}
+
+} // namespace
+
+TEST_CASE("Ppu_TileCache", "[ppu]") {
+  const auto rom = createChrRamRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+
+  // Tile $21 of the right pattern table, row 3
+  // Low bitplane: 10110000, high bitplane: 01100001
+  writeChr(ppu, 0x1213, 0xb0);
+  writeChr(ppu, 0x121b, 0x61);
+
+  CHECK(ppu.decodedTileRow(0x1213, false) == std::array<uint8_t, 8>{1, 2, 3, 1, 0, 0, 0, 2});
+  CHECK(ppu.decodedTileRow(0x1213, true) == std::array<uint8_t, 8>{2, 0, 0, 0, 1, 3, 2, 1});
+
+  // The other rows of the tile are still empty
+  CHECK(ppu.decodedTileRow(0x1212, false) == std::array<uint8_t, 8>{});
+
+  // Writing to CHR-RAM invalidates the decoded tile
+  writeChr(ppu, 0x121b, 0x00);
+
+  CHECK(ppu.decodedTileRow(0x1213, false) == std::array<uint8_t, 8>{1, 0, 1, 1, 0, 0, 0, 0});
+  CHECK(ppu.decodedTileRow(0x1213, true) == std::array<uint8_t, 8>{0, 0, 0, 0, 1, 1, 0, 1});
+}
+
+TEST_CASE("Ppu_TileCacheBankSwitch", "[ppu]") {
+  const auto rom = createChrRomRom();
+
+  Cartridge cartridge;
+  REQUIRE(cartridge.LoadRom(rom.data(), rom.size()));
+
+  Ppu ppu(cartridge, [] {});
+  ppu.Power();
+  ppu.UpdateChrPages();
+
+  CHECK(ppu.decodedTileRow(0x0123, false) == std::array<uint8_t, 8>{});
+
+  // Switching banks doesn't invalidate every decoded tile, but the ones of the switched pages are
+  // decoded again from the new bank
+  const auto chrGeneration = cartridge.chrGeneration;
+
+  cartridge.WritePRG(0x8000, 1);
+  ppu.UpdateChrPages();
+
+  CHECK(cartridge.chrGeneration == chrGeneration);
+  CHECK(ppu.decodedTileRow(0x0123, false) == std::array<uint8_t, 8>{3, 3, 3, 3, 3, 3, 3, 3});
+
+  cartridge.WritePRG(0x8000, 0);
+  ppu.UpdateChrPages();
+
+  CHECK(ppu.decodedTileRow(0x0123, false) == std::array<uint8_t, 8>{});
+}